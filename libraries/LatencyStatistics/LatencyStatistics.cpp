@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "LatencyStatistics.hpp"
+
+#include <algorithm> // std::clamp, std::max, std::min
+#include <fstream>
+
+#include <yarp/os/LogStream.h>
+
+using namespace roboticslab;
+
+LatencyStatistics::LatencyStatistics(const std::string & _source, double _binWidth, int _numBins)
+    : source(_source),
+      binWidth(_binWidth),
+      numBins(_numBins)
+{}
+
+void LatencyStatistics::record(std::string_view key, std::string_view stage, double value)
+{
+    std::lock_guard lock(mutex);
+
+    auto it = histograms.find(std::pair(key, stage));
+
+    if (it == histograms.end())
+    {
+        it = histograms.try_emplace({std::string(key), std::string(stage)}).first;
+
+        auto & histogram = it->second;
+        histogram.source = source;
+        histogram.key = key;
+        histogram.stage = stage;
+        histogram.count = 0;
+        histogram.mean = 0.0;
+        histogram.min = histogram.max = value;
+        histogram.binWidth = binWidth;
+        histogram.bins.assign(numBins, 0);
+    }
+
+    auto & histogram = it->second;
+    histogram.count++;
+    histogram.mean += (value - histogram.mean) / histogram.count;
+    histogram.min = std::min(histogram.min, value);
+    histogram.max = std::max(histogram.max, value);
+    histogram.bins[std::clamp(static_cast<int>(value / binWidth), 0, numBins - 1)]++;
+}
+
+void LatencyStatistics::clear()
+{
+    std::lock_guard lock(mutex);
+    histograms.clear();
+}
+
+std::vector<LatencyHistogram> LatencyStatistics::getHistograms() const
+{
+    std::lock_guard lock(mutex);
+    std::vector<LatencyHistogram> out;
+    out.reserve(histograms.size());
+
+    for (const auto & [id, histogram] : histograms)
+    {
+        out.push_back(histogram);
+    }
+
+    return out;
+}
+
+bool LatencyStatistics::appendToCsv(const std::string & path, int run, const std::vector<LatencyHistogram> & histograms)
+{
+    bool exists = std::ifstream(path).good();
+    std::ofstream out(path, std::ios::app);
+
+    if (!out)
+    {
+        yError() << "Unable to open" << path << "for writing";
+        return false;
+    }
+
+    if (!exists)
+    {
+        out << "run,source,key,stage,count,mean,min,max,bin_width,bins\n";
+    }
+
+    for (const auto & histogram : histograms)
+    {
+        out << run << ',' << histogram.source << ',' << histogram.key << ',' << histogram.stage << ','
+            << histogram.count << ',' << histogram.mean << ',' << histogram.min << ',' << histogram.max << ','
+            << histogram.binWidth << ',';
+
+        for (auto i = 0; i < histogram.bins.size(); i++)
+        {
+            out << (i == 0 ? "" : " ") << histogram.bins[i];
+        }
+
+        out << '\n';
+    }
+
+    return static_cast<bool>(out);
+}
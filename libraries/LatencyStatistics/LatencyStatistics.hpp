@@ -0,0 +1,62 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __LATENCY_STATISTICS_HPP__
+#define __LATENCY_STATISTICS_HPP__
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_libraries
+ * @brief Thread-safe collection of latency histograms indexed by key (sentence, action...) and stage.
+ *
+ * Samples beyond the last bin are accumulated in it (overflow bin).
+ */
+class LatencyStatistics
+{
+public:
+    LatencyStatistics(const std::string & source, double binWidth, int numBins);
+
+    //! Does not allocate unless this key and stage are new.
+    void record(std::string_view key, std::string_view stage, double value);
+    void clear();
+
+    std::vector<LatencyHistogram> getHistograms() const;
+
+    //! Append the histograms to a CSV file (header is written only on file creation).
+    static bool appendToCsv(const std::string & path, int run, const std::vector<LatencyHistogram> & histograms);
+
+private:
+    const std::string source;
+    const double binWidth;
+    const int numBins;
+
+    mutable std::mutex mutex;
+    //! Orders (key, stage) pairs of any string type, so that lookups need no std::string.
+    struct Less
+    {
+        using is_transparent = void;
+
+        template <typename T, typename U>
+        bool operator()(const T & lhs, const U & rhs) const
+        {
+            return std::pair<std::string_view, std::string_view>(lhs.first, lhs.second)
+                 < std::pair<std::string_view, std::string_view>(rhs.first, rhs.second);
+        }
+    };
+
+    std::map<std::pair<std::string, std::string>, LatencyHistogram, Less> histograms;
+};
+
+} // namespace roboticslab
+
+#endif // __LATENCY_STATISTICS_HPP__
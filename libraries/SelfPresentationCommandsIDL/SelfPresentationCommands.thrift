@@ -1,5 +1,39 @@
 namespace yarp roboticslab
 
+enum ActionPolicy
+{
+    POLICY_REPLACE = 0,
+    POLICY_ENQUEUE = 1,
+    POLICY_BLEND = 2
+}
+
+struct LatencyHistogram
+{
+    1: string source;
+    2: string key;
+    3: string stage;
+    4: i32 count;
+    5: double mean;
+    6: double min;
+    7: double max;
+    8: double binWidth;
+    9: list<i32> bins;
+}
+
+struct DurationEstimate
+{
+    1: string action;
+    2: double total;
+    3: list<double> waypoints;
+}
+
+struct VoiceDescription
+{
+    1: string language;
+    2: string backend;
+    3: string model;
+}
+
 service SelfPresentationCommands
 {
     oneway void doGreet();
@@ -13,6 +47,39 @@ service SelfPresentationCommands
     oneway void doExplanationLeftPC();
     oneway void doExplanationInsidePC();
     oneway void doExplanationSensors();
+    i32 doAction(1: string name, 2: ActionPolicy policy);
+    // waypoints: packed doubles [deg], one row of 14 joints per waypoint (same order as the motion library)
+    // durations: empty or one packed double per segment between consecutive waypoints [s]
+    i32 doTrajectory(1: binary waypoints, 2: binary durations, 3: ActionPolicy policy);
+    // file name of a joint log in the directory given by --recordDir on the server side
+    i32 doReplay(1: string name, 2: ActionPolicy policy);
+    bool startRecording(1: string name);
+    bool stopRecording();
     bool checkMotionDone();
+    string getStartupState();
+    bool checkActionDone(1: i32 id);
+    DurationEstimate estimateDuration(1: string action);
+    list<DurationEstimate> estimateDurations();
     bool stop();
+    list<LatencyHistogram> getStats();
+    // clear the histograms returned by getStats, e.g. at the start of a presentation
+    bool resetStats();
+    map<string, i32> getSuppressionCounters();
+}
+
+// word timing, complements the SpeechSynthesis interface of TTS servers that can tell
+service SpeechTiming
+{
+    // start of each word of the last utterance [s], relative to the return of say()
+    // words are separated by whitespace, empty if unknown
+    list<double> getWordOffsets();
+}
+
+// runtime commands of dialogueManager
+service DialogueManagerCommands
+{
+    // language and TTS backend of the next presentations, an empty backend keeps the current one
+    bool setLanguage(1: string language, 2: string backend);
+    VoiceDescription getLanguage();
+    list<VoiceDescription> getLanguages();
 }
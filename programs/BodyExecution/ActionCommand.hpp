@@ -0,0 +1,49 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __ACTION_COMMAND_HPP__
+#define __ACTION_COMMAND_HPP__
+
+#include <cstdint>
+
+#include <atomic>
+
+#include "CommandQueue.hpp"
+#include "MotionLibrary.hpp"
+#include "TrajectoryPlanner.hpp"
+
+namespace roboticslab
+{
+
+//! Request posted by the RPC thread to the control loop.
+struct ActionCommand
+{
+    enum class Type { Execute, Stop };
+
+    //! Replace: abort current and queued actions. Enqueue: start once the current one is done.
+    //! Blend: like enqueue, but without coming to a stop in between (if supported).
+    enum class Policy { Replace, Enqueue, Blend };
+
+    Type type { Type::Stop };
+    const MotionLibrary::Action * action { nullptr };
+    std::int32_t id { 0 };
+    Policy policy { Policy::Replace };
+    const TrajectoryPlanner::Trajectory * trajectory { nullptr }; // precomputed or uploaded, outlives the action
+};
+
+//! Snapshot published by the control loop after each command or completion.
+struct ActionStatus
+{
+    std::int32_t taken { 0 }; // latest action taken from the queue
+    std::int32_t finished { 0 }; // latest action done or aborted by the control loop
+
+    bool isActive() const
+    { return finished != taken; }
+};
+
+static_assert(std::atomic<ActionStatus>::is_always_lock_free);
+
+using ActionQueue = CommandQueue<ActionCommand, 16>;
+
+} // namespace roboticslab
+
+#endif // __ACTION_COMMAND_HPP__
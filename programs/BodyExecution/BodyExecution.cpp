@@ -2,339 +2,1826 @@
 
 #include "BodyExecution.hpp"
 
-#include <cmath> // std::abs
+#include <cmath> // std::abs, std::isfinite
+#include <cstdio> // std::snprintf
+#include <cstring> // std::memcpy
 
-#include <algorithm> // std::max_element, std::transform
+#include <algorithm> // std::all_of, std::copy, std::find_if, std::max, std::replace
+#include <array>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <numeric> // std::iota
+#include <string> // std::to_string
+#include <thread> // std::this_thread::yield
+#include <utility> // std::move, std::pair
 #include <vector>
 
 #include <yarp/os/LogStream.h>
+#include <yarp/os/Os.h>
 #include <yarp/os/Property.h>
+#include <yarp/os/SystemClock.h>
+
+#include <yarp/dev/IAxisInfo.h>
+#include <yarp/dev/IControlLimits.h>
+#include <yarp/dev/IMultipleWrapper.h>
+#include <yarp/dev/PolyDriverList.h>
 
 using namespace roboticslab;
 
 constexpr auto DEFAULT_ROBOT = "/teo"; // teo or teoSim
-constexpr auto DEFAULT_PREFIX = "/bodyExecution";
 constexpr auto DEFAULT_REF_SPEED = 25.0; // [m/s]
 constexpr auto DEFAULT_REF_ACCELERATION = 25.0; // [m/s^2]
+constexpr auto DEFAULT_MAX_JERK = 100.0; // [deg/s^3]
+constexpr auto DEFAULT_LIMITS = "limits.ini";
+constexpr auto DEFAULT_STARTUP_TIMEOUT = 30.0; // [s]
+constexpr auto DEFAULT_REF_TOLERANCE = 0.01; // [deg/s], [deg/s^2]
+constexpr auto DEFAULT_RECORD_RATE = 50.0; // [Hz]
+constexpr auto DEFAULT_KINEMATICS = "kinematics.ini";
+constexpr auto DEFAULT_VALIDATION_CACHE = "validation.cache";
+constexpr auto DEFAULT_RECORD_DIR = "recordings";
+constexpr auto DEFAULT_LIBRARY = "motions.ini"; // text source or compiled *.bin
+constexpr auto DEFAULT_STREAMING_RATE = 200.0; // [Hz]
+constexpr auto DEFAULT_MAX_STATE_AGE = 0.05; // [s]
+constexpr auto DEFAULT_CONTROL_PERIOD = 0.02; // [s]
+
+namespace
+{
+    bool toCommandPolicy(ActionPolicy policy, ActionCommand::Policy & out)
+    {
+        switch (policy)
+        {
+        case POLICY_REPLACE:
+            out = ActionCommand::Policy::Replace;
+            return true;
+        case POLICY_ENQUEUE:
+            out = ActionCommand::Policy::Enqueue;
+            return true;
+        case POLICY_BLEND:
+            out = ActionCommand::Policy::Blend;
+            return true;
+        default:
+            yWarning() << "Unknown action policy:" << policy;
+            return false;
+        }
+    }
+
+    // same order as setpoints_t
+    constexpr std::array<const char *, std::tuple_size_v<BodyExecution::setpoints_t>> PARTS = {"head", "leftArm", "rightArm"};
+
+    // offset of each part in the flattened joint vector
+    constexpr auto PART_OFFSETS = std::apply([](auto... parts) {
+        std::array<std::size_t, sizeof...(parts) + 1> offsets {0, std::tuple_size_v<decltype(parts)>...};
+
+        for (auto i = 1; i < offsets.size(); i++)
+        {
+            offsets[i] += offsets[i - 1];
+        }
+
+        return offsets;
+    }, BodyExecution::setpoints_t{});
+
+    constexpr auto DISPATCH_LEAD = 0.001; // [s], lets all part threads wake up before the common start
+    constexpr auto EVENT_POLL_PERIOD = 0.002; // [s], events carry their own timestamp
+
+    // file name of a joint log, never a path outside of the log directory
+    bool isLogName(const std::string & name)
+    {
+        return !name.empty() && name != "." && name.find("..") == std::string::npos && name.find_first_of("/\\") == std::string::npos;
+    }
 
-constexpr BodyExecution::setpoints_head_t headZeros { 0.0, 0.0 };
-constexpr BodyExecution::setpoints_arm_t armZeros { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    const std::vector<std::string> AXES = {
+        "AxialNeck", "FrontalNeck",
+        "FrontalLeftShoulder", "SagittalLeftShoulder", "AxialLeftShoulder", "FrontalLeftElbow", "AxialLeftWrist", "FrontalLeftWrist",
+        "FrontalRightShoulder", "SagittalRightShoulder", "AxialRightShoulder", "FrontalRightElbow", "AxialRightWrist", "FrontalRightWrist"
+    };
+}
 
 bool BodyExecution::configure(yarp::os::ResourceFinder & rf)
 {
     auto robot = rf.check("robot", yarp::os::Value(DEFAULT_ROBOT), "remote robot port prefix").asString();
+    auto prefix = rf.check("prefix", yarp::os::Value(DEFAULT_PREFIX), "local port prefix").asString();
+    return open(rf, robot, prefix, 0.0, "");
+}
+
+bool BodyExecution::configureHosted(yarp::os::ResourceFinder & rf, const std::string & robot, const std::string & prefix, double period)
+{
+    // e.g. /teoSim1 -> teoSim1, keeps the files of each instance apart
+    auto start = robot.find_first_not_of('/');
+    auto instance = start == std::string::npos ? std::string() : robot.substr(start);
+    std::replace(instance.begin(), instance.end(), '/', '_');
+    return open(rf, robot, prefix, period, instance.empty() ? "default" : instance);
+}
+
+bool BodyExecution::open(yarp::os::ResourceFinder & rf, const std::string & robot, const std::string & prefix, double hostPeriod, const std::string & instance)
+{
+    auto libraryName = rf.check("library", yarp::os::Value(DEFAULT_LIBRARY), "motion library file").asString();
+    auto limitsName = rf.check("limits", yarp::os::Value(DEFAULT_LIMITS), "joint limits file").asString();
+    auto streamingRate = rf.check("streamingRate", yarp::os::Value(DEFAULT_STREAMING_RATE), "streaming rate [Hz]").asFloat64();
+    auto maxStateAge = rf.check("maxStateAge", yarp::os::Value(DEFAULT_MAX_STATE_AGE), "max age of streamed joint state [s]").asFloat64();
+    auto controlPeriod = rf.check("controlPeriod", yarp::os::Value(DEFAULT_CONTROL_PERIOD), "control thread period [s]").asFloat64();
+    auto controlPriority = rf.check("controlPriority", yarp::os::Value(-1), "control thread SCHED_FIFO priority").asInt32();
+    auto controlCpu = rf.check("controlCpu", yarp::os::Value(-1), "control thread CPU affinity").asInt32();
+    auto startupTimeout = rf.check("startupTimeout", yarp::os::Value(DEFAULT_STARTUP_TIMEOUT), "max wait for the robot [s]").asFloat64();
+    bool streaming = rf.check("streaming");
+    bool useControlThread = rf.check("controlThread");
+    bool partDispatch = rf.check("partDispatch");
+    auto kinematicsName = rf.check("kinematics", yarp::os::Value(DEFAULT_KINEMATICS), "kinematic model file for self-collision checks").asString();
+    auto validationCache = rf.check("validationCache", yarp::os::Value(""), "validation cache file").asString();
+    auto recordRate = rf.check("recordRate", yarp::os::Value(DEFAULT_RECORD_RATE), "joint recorder rate [Hz]").asFloat64();
+    auto recordDirectory = rf.check("recordDir", yarp::os::Value(""), "directory of joint logs").asString();
+    auto refTolerance = rf.check("refTolerance", yarp::os::Value(DEFAULT_REF_TOLERANCE), "min change of reference speeds and accelerations to be sent").asFloat64();
 
     if (rf.check("help"))
     {
         yInfo("BodyExecution options:");
         yInfo("\t--help (this help)\t--from [file.ini]\t--context [path]");
         yInfo("\t--robot: %s [%s]", robot.c_str(), DEFAULT_ROBOT);
+        yInfo("\t--prefix: %s [%s]", prefix.c_str(), DEFAULT_PREFIX);
+        yInfo("\t--robots: [(robot1 robot2 ...)] (host one instance per robot in this process, ports at %s/robotN)", DEFAULT_PREFIX);
+        yInfo("\t--workers: [N] (threads shared by hosted instances, defaults to the number of cores)");
+        yInfo("\t--hostPeriod: [s] (control and streaming period of hosted instances)");
+        yInfo("\t--startupTimeout: %f [%f]", startupTimeout, DEFAULT_STARTUP_TIMEOUT);
+        yInfo("\t--library: %s [%s]", libraryName.c_str(), DEFAULT_LIBRARY);
+        yInfo("\t--compile: [file.bin] (compile motion library and exit)");
+        yInfo("\t--limits: %s [%s]", limitsName.c_str(), DEFAULT_LIMITS);
+        yInfo("\t--streaming (stream interpolated trajectories through position direct mode)");
+        yInfo("\t--streamingRate: %f [%f]", streamingRate, DEFAULT_STREAMING_RATE);
+        yInfo("\t--maxStateAge: %f [%f]", maxStateAge, DEFAULT_MAX_STATE_AGE);
+        yInfo("\t--controlThread (run control logic in a dedicated periodic thread)");
+        yInfo("\t--partDispatch (send position commands to each body part concurrently)");
+        yInfo("\t--refTolerance: %f [%f]", refTolerance, DEFAULT_REF_TOLERANCE);
+        yInfo("\t--recordRate: %f [%f]", recordRate, DEFAULT_RECORD_RATE);
+        yInfo("\t--recordDir: [path] (joint logs are written and replayed only here, defaults to %s in the home context path, one subdirectory per hosted robot)", DEFAULT_RECORD_DIR);
+        yInfo("\t--kinematics: %s [%s] (empty to skip self-collision checks)", kinematicsName.c_str(), DEFAULT_KINEMATICS);
+        yInfo("\t--validationCache: [path] (defaults to %s in the home context path, suffixed with the robot name if hosted)", DEFAULT_VALIDATION_CACHE);
+        yInfo("\t--controlPeriod: %f [%f]", controlPeriod, DEFAULT_CONTROL_PERIOD);
+        yInfo("\t--controlPriority: %d [-1] (SCHED_FIFO, requires privileges)", controlPriority);
+        yInfo("\t--controlCpu: %d [-1]", controlCpu);
         return false;
     }
 
-    yarp::os::Property robotOptions {
-        {"device", yarp::os::Value("remotecontrolboardremapper")},
-        {"localPortPrefix", yarp::os::Value(DEFAULT_PREFIX)}
-    };
-
-    yarp::os::Bottle remotePorts {
-        yarp::os::Value(robot + "/head"),
-        yarp::os::Value(robot + "/leftArm"),
-        yarp::os::Value(robot + "/rightArm")
-    };
-
-    robotOptions.put("remoteControlBoards", yarp::os::Value::makeList(remotePorts.toString().c_str()));
-
-    yarp::os::Bottle axesNames {
-        yarp::os::Value("AxialNeck"), yarp::os::Value("FrontalNeck"),
-        yarp::os::Value("FrontalLeftShoulder"), yarp::os::Value("SagittalLeftShoulder"), yarp::os::Value("AxialLeftShoulder"),
-        yarp::os::Value("FrontalLeftElbow"), yarp::os::Value("AxialLeftWrist"), yarp::os::Value("FrontalLeftWrist"),
-        yarp::os::Value("FrontalRightShoulder"), yarp::os::Value("SagittalRightShoulder"), yarp::os::Value("AxialRightShoulder"),
-        yarp::os::Value("FrontalRightElbow"), yarp::os::Value("AxialRightWrist"), yarp::os::Value("FrontalRightWrist")
-    };
-
-    robotOptions.put("axesNames", yarp::os::Value::makeList(axesNames.toString().c_str()));
-
-    if (!robotDevice.open(robotOptions))
+    if (streaming && streamingRate <= 0.0)
     {
-        yError() << "Failed to open robot device";
+        yError() << "Illegal streaming rate:" << streamingRate;
         return false;
     }
 
-    if (!robotDevice.view(iControlMode) || !robotDevice.view(iEncoders) || !robotDevice.view(iPositionControl))
+    if (recordRate <= 0.0)
     {
-        yError() << "Failed to view robot interfaces";
+        yError() << "Illegal record rate:" << recordRate;
         return false;
     }
 
-    if (!iControlMode->setControlModes(std::vector(axesNames.size(), VOCAB_CM_POSITION).data()))
+    recordPeriod = 1.0 / recordRate;
+    recordDir = recordDirectory.empty() ? rf.getHomeContextPath() + "/" + DEFAULT_RECORD_DIR : recordDirectory;
+
+    if (!instance.empty())
     {
-        yError() << "Failed to set position control mode";
-        return false;
+        recordDir += "/" + instance;
     }
 
-    if (!iPositionControl->setRefSpeeds(std::vector(axesNames.size(), DEFAULT_REF_SPEED).data()))
+    if (useControlThread && hostPeriod <= 0.0 && controlPeriod <= 0.0)
     {
-        yError() << "Failed to set reference speeds";
+        yError() << "Illegal control period:" << controlPeriod;
         return false;
     }
 
-    if (!iPositionControl->setRefAccelerations(std::vector(axesNames.size(), DEFAULT_REF_ACCELERATION).data()))
+    refSpeedShadow.setTolerance(refTolerance);
+    refAccelerationShadow.setTolerance(refTolerance);
+
+    startupBegin = yarp::os::SystemClock::nowSystem();
+
+    // ports first, so that clients may connect (and query the startup state) while warming up
+    if (!statePort.open(prefix + "/state:o"))
     {
-        // might not be available in certain implementations, e.g. OpenRAVE
-        yWarning() << "Failed to set reference accelerations";
+        yError() << "Unable to open state port";
+        return false;
     }
 
-    if (!serverPort.open(DEFAULT_PREFIX + std::string("/rpc:s")))
+    if (!serverPort.open(prefix + "/rpc:s"))
     {
         yError() << "Unable to open RPC port";
         return false;
     }
 
-    return yarp::os::Wire::yarp().attachAsServer(serverPort);
-}
-
-bool BodyExecution::close()
-{
-    serverPort.close();
-    robotDevice.close();
-    return true;
-}
+    if (!yarp::os::Wire::yarp().attachAsServer(serverPort))
+    {
+        yError() << "Unable to attach RPC server";
+        return false;
+    }
 
-bool BodyExecution::interruptModule()
-{
-    serverPort.interrupt();
+    StartupOptions options;
+    options.robot = robot;
+    options.prefix = prefix;
+    options.library = rf.findFileByName(libraryName);
+    options.limits = rf.findFileByName(limitsName);
+    options.streamingPeriod = hostPeriod > 0.0 ? hostPeriod : 1.0 / streamingRate; // hosted instances are stepped at the host rate
+    options.maxStateAge = maxStateAge;
+    options.timeout = startupTimeout;
+    options.streaming = streaming;
+    options.isHosted = hostPeriod > 0.0;
+    options.useControlThread = useControlThread;
+    options.controlPeriod = controlPeriod;
+    options.controlPriority = controlPriority;
+    options.controlCpu = controlCpu;
+    options.partDispatch = partDispatch;
+    options.kinematics = kinematicsName.empty() ? "" : rf.findFileByName(kinematicsName);
+    options.validationCache = validationCache.empty() ? rf.getHomeContextPath() + "/" + DEFAULT_VALIDATION_CACHE : validationCache;
 
-    if (int numAxes; !iEncoders->getAxes(&numAxes) || !iPositionControl->setRefSpeeds(std::vector(numAxes, DEFAULT_REF_SPEED).data()))
+    if (!instance.empty())
     {
-        yWarning() << "Failed to restore reference speeds";
+        options.validationCache += "." + instance; // validated in parallel by each startup thread
     }
 
-    return stop();
-}
+    state = State::WarmingUp;
+    eventThread = std::thread(&BodyExecution::publishEvents, this);
 
-double BodyExecution::getPeriod()
-{
-    return 0.1; // [s]
+    startupThread = std::thread([this, options] {
+        if (warmUp(options))
+        {
+            yInfo("Ready to accept commands %.3f s after start", yarp::os::SystemClock::nowSystem() - startupBegin);
+            state = State::Ready;
+        }
+        else
+        {
+            state = State::Failed;
+        }
+    });
+
+    return true;
 }
 
-bool BodyExecution::updateModule()
+bool BodyExecution::warmUp(const StartupOptions & options)
 {
-    bool isMotionDone = true;
+    auto t0 = yarp::os::SystemClock::nowSystem();
 
-    if (!iPositionControl->checkMotionDone(&isMotionDone))
+    if (!loadLibrary(options.library) || !loadLimits(options.limits) || !library.hasAxes(AXES))
     {
-        yWarning() << "Unable to check motion state";
+        return false;
     }
 
-    std::unique_lock lock(actionMutex);
+    auto t1 = yarp::os::SystemClock::nowSystem();
 
-    if (isProcessingSetpoints && isMotionDone && currentSetpoints.empty())
+    if (!openDevices(options.robot, options.prefix, options.timeout))
     {
-        currentAction = noAction; // motion done and no more points to send
-        isProcessingSetpoints = false;
+        return false;
     }
 
-    yDebugThrottle(1.0) << "Current action:" << currentAction;
-
-    if (isProcessingSetpoints && isMotionDone && !currentSetpoints.empty())
+    if (!robotDevice.view(iControlMode) || !robotDevice.view(iEncoders) || !robotDevice.view(iPositionControl))
     {
-        yDebug() << "Sending new setpoints:" << currentSetpoints.front();
+        yError() << "Failed to view robot interfaces";
+        return false;
+    }
 
-        auto [head, leftArm, rightArm] = currentSetpoints.front();
-        currentSetpoints.pop_front();
-        lock.unlock();
+    if (!stateCache.configure(iEncoders, library.getNumAxes(), options.maxStateAge))
+    {
+        yError() << "Failed to configure joint state cache";
+        return false;
+    }
 
-        std::vector<double> values;
-        values.insert(values.end(), head.cbegin(), head.cend());
-        values.insert(values.end(), leftArm.cbegin(), leftArm.cend());
-        values.insert(values.end(), rightArm.begin(), rightArm.end());
+    for (auto i = 0; i < PARTS.size(); i++)
+    {
+        const auto remote = options.robot + "/" + PARTS[i] + "/state:o";
 
-        if (!sendMotionCommand(values))
+        if (!stateCache.subscribe(remote, options.prefix + "/" + PARTS[i] + "/state:i", PART_OFFSETS[i], PART_OFFSETS[i + 1] - PART_OFFSETS[i]))
         {
-            yWarning() << "Failed to send new setpoints";
+            yWarning() << "No state stream from" << PARTS[i] << "- all joint positions will be queried through the remapper";
         }
     }
 
-    return true;
-}
-
-bool BodyExecution::sendMotionCommand(const std::vector<double> & targets)
-{
-    std::vector<double> q(targets.size());
+    auto t2 = yarp::os::SystemClock::nowSystem();
 
-    if (!iEncoders->getEncoders(q.data()))
+    if (!configureParts(options.streaming ? VOCAB_CM_POSITION_DIRECT : VOCAB_CM_POSITION))
     {
-        yWarning() << "Failed to get current encoder values";
         return false;
     }
 
-    std::vector<double> deltas(targets.size());
+    auto t3 = yarp::os::SystemClock::nowSystem();
 
-    std::transform(targets.cbegin(), targets.cend(), q.cbegin(), deltas.begin(), [](auto target, auto current) {
-        return std::abs(target - current);
-    });
-
-    if (double maxDelta = *std::max_element(deltas.cbegin(), deltas.cend()); maxDelta != 0.0)
+    if (!validateLibrary(options.kinematics, options.validationCache, options.streaming))
     {
-        std::vector<int> indices;
-        std::vector<double> refSpeeds;
-        std::vector<double> groupTargets;
+        return false;
+    }
 
-        for (auto i = 0; i < deltas.size(); i++)
+    auto t4 = yarp::os::SystemClock::nowSystem();
+
+    if (options.partDispatch && options.streaming)
+    {
+        yWarning() << "Ignoring --partDispatch, only available in position mode";
+    }
+    else if (options.partDispatch)
+    {
+        for (auto i = 0; i < PARTS.size(); i++)
         {
-            if (deltas[i] != 0.0)
+            if (!partDevices[i].view(partPositionControls[i]))
             {
-                indices.push_back(i);
-                refSpeeds.push_back(DEFAULT_REF_SPEED * deltas[i] / maxDelta); // isochronous motion
-                groupTargets.push_back(targets[i]);
+                yError() << "Failed to view position control interface of" << PARTS[i];
+                return false;
             }
         }
 
-        if (!iPositionControl->setRefSpeeds(indices.size(), indices.data(), refSpeeds.data()))
+        dispatchPool = std::make_unique<WorkerPool>(PARTS.size()); // including the control loop, see WorkerPool::run()
+    }
+
+    if (options.streaming)
+    {
+        if (!robotDevice.view(iPositionDirect))
         {
-            yWarning() << "Failed to set reference speeds";
+            yError() << "Failed to view position direct interface";
             return false;
         }
 
-        if (!iPositionControl->positionMove(indices.size(), indices.data(), groupTargets.data()))
+        streamer = std::make_unique<TrajectoryStreamer>(options.streamingPeriod, planner);
+
+        if (!streamer->configure(&stateCache, iPositionDirect, library.getNumAxes()))
         {
-            yWarning() << "Failed to send motion command";
+            yError() << "Failed to configure trajectory streamer";
+            return false;
+        }
+
+        streamer->setStartCallback([this](const auto * action, auto id) {
+            publishEvent("moving", action, id);
+        });
+
+        streamer->setWaypointCallback([this](const auto * action, auto id, auto waypoint) {
+            publishEvent("waypoint", action, id, waypoint);
+
+            if (waypoint == action->size - 1)
+            {
+                publishEvent("done", action, id);
+            }
+        });
+
+        streamer->setAbortCallback([this](const auto * action, auto id) {
+            publishEvent("aborted", action, id);
+        });
+
+        if (!options.isHosted && !streamer->start())
+        {
+            yError() << "Failed to start trajectory streamer";
             return false;
         }
     }
-    else
+
+    if (options.useControlThread && options.isHosted)
     {
-        yWarning() << "No motion to perform, already on target";
+        yWarning() << "Ignoring --controlThread, hosted instances are driven by the host";
+    }
+    else if (options.useControlThread)
+    {
+        controlThread = std::make_unique<ControlThread>(options.controlPeriod, options.controlPriority, options.controlCpu, [this] { controlStep(); });
+
+        if (!controlThread->start())
+        {
+            yError() << "Failed to start control thread";
+            return false;
+        }
     }
 
+    auto t5 = yarp::os::SystemClock::nowSystem();
+
+    yInfo("Startup phases: library and planning %.3f s, robot connection %.3f s, robot configuration %.3f s, validation %.3f s, control threads %.3f s",
+          t1 - t0, t2 - t1, t3 - t2, t4 - t3, t5 - t4);
+
     return true;
 }
 
-void BodyExecution::doGreet()
+bool BodyExecution::openDevices(const std::string & robot, const std::string & prefix, double timeout)
 {
-    registerSetpoints("greet", {
-        {headZeros, armZeros, {-45.0, 0.0, -20.0, -80.0, 0.0, 0.0}},
-        {headZeros, armZeros, {-45.0, 0.0, 20.0, -80.0, 0.0, 0.0}},
-        {headZeros, armZeros, {-45.0, 0.0, -20.0, -80.0, 0.0, 0.0}},
-    });
-}
+    auto deadline = yarp::os::SystemClock::nowSystem() + timeout;
+    std::array<std::future<bool>, PARTS.size()> opened;
 
-void BodyExecution::doHoming()
-{
-    registerSetpoints("homing", {
-        {headZeros, armZeros, armZeros}
-    });
-}
+    // boards are independent, connect to all of them at once
+    for (auto i = 0; i < PARTS.size(); i++)
+    {
+        opened[i] = std::async(std::launch::async, [this, i, &robot, &prefix, deadline] {
+            yarp::os::Property options {
+                {"device", yarp::os::Value("remote_controlboard")},
+                {"remote", yarp::os::Value(robot + "/" + PARTS[i])},
+                {"local", yarp::os::Value(prefix + "/" + PARTS[i])}
+            };
 
-void BodyExecution::doExplanation1()
-{
-    registerSetpoints("explanation 1", {
-        {headZeros, armZeros, {17.03, -22.65, -1.49, -88.75, 2.36, -53.78}},
-        {{-60.0, 0.0}, armZeros, {-65.00, -79.42, -6.24, -88.66, 31.44, 31.18}},
-        {headZeros, {-68.75, 10.53, -16.59, -96.57, -34.89, -9.02}, {17.03, -22.65, -1.49, -88.75, 2.36, -53.78}},
-    });
-}
+            // the robot may be still booting, retry until the deadline
+            while (!partDevices[i].open(options))
+            {
+                if (closing || yarp::os::SystemClock::nowSystem() > deadline)
+                {
+                    yError() << "Failed to open remote control board" << robot + "/" + PARTS[i];
+                    return false;
+                }
 
-void BodyExecution::doExplanation2()
-{
-    registerSetpoints("explanation 2", {
-        {headZeros, {-39.46, -0.50, 5.09, -58.08, -29.75, -52.80}, {-39.12, -3.60, -5.90, -64.95, 29.75, -56.96}},
-        {headZeros, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-    });
-}
+                yarp::os::SystemClock::delaySystem(0.5);
+            }
 
-void BodyExecution::doExplanation3()
-{
-    registerSetpoints("explanation 3", {
-        {headZeros, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-        {headZeros, {-63.12, -3.60, -5.90, -80.95, 10.25, -39.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -58.58}},
-        {headZeros, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-    });
-}
+            return true;
+        });
+    }
 
-void BodyExecution::doExplanation4()
-{
-    registerSetpoints("explanation 4", {
-        {headZeros, {-39.46, -0.50, 5.09, -58.08, -29.75, -52.80}, {-39.12, -3.60, -5.90, -64.95, 29.75, -56.96}},
-        {headZeros, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-        {{0.0, 10.0}, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-        {{0.0, -10.0}, {-63.12, -3.60, -5.90, -80.95, 10.25, -19.75}, {-63.80, -3.85, -3.60, -65.20, -12.65, -38.58}},
-    });
-}
+    bool ok = true;
 
-void BodyExecution::doExplanationHead()
-{
-    registerSetpoints("explanation head", {
-        {{20.0, 10.0}, {-70.90, -1.30, -48.51, -93.04, -8.96, -52.80}, armZeros}
-    });
-}
+    for (auto & future : opened)
+    {
+        ok &= future.get();
+    }
 
-void BodyExecution::doExplanationRightPC()
-{
-    registerSetpoints("explanation right PC", {
-        {{-20.0, 10.0}, armZeros, {-63.53, -8.15, 34.52, -72.23, 32.32, -85.17}}
-    });
-}
+    if (!ok)
+    {
+        return false;
+    }
 
-void BodyExecution::doExplanationLeftPC()
-{
-    registerSetpoints("explanation left PC", {
-        {{20.0, 10.0}, armZeros, {-64.93, 8.96, 54.29, -72.32, 40.40, -50.00}}
-    });
-}
+    yarp::os::Bottle axesNames;
 
-void BodyExecution::doExplanationInsidePC()
-{
-    // left arm without plate (wrist = -79.961016)
-    registerSetpoints("explanation inside PC", {
-        {{20.0, 10.0}, {-37.96, 15.48, -29.75, -94.64, -20.31, -52.80}, armZeros}
-    });
-}
+    for (const auto & axis : AXES)
+    {
+        axesNames.addString(axis);
+    }
 
-void BodyExecution::doExplanationSensors()
-{
-    registerSetpoints("explanation sensors", {
-        {{15.0, 10.0}, {-55.87, -11.32, -27.07, -87.33, -38.84, -43.04}, {-42.00, 5.98, 38.03, -76.98, 48.93, -36.20}},
-        {{15.0, 10.0}, {-44.80, 14.32, -9.31, -79.95, -44.64, -52.80}, {-42.00, 5.98, 38.03, -76.98, 48.93, -36.20}},
-        {{15.0, 10.0}, {-44.80, 14.32, -9.31, -79.95, -44.64, -52.80}, {-64.32, 13.71, 38.12, -76.98, 48.84, -43.15}},
-        {{-15.0, 10.0}, {-62.11, -3.50, -28.91, -66.68, -55.27, -52.80}, {-65.47, 14.85, 36.45, -76.98, 21.33, -56.15}},
-    });
+    yarp::os::Property remapperOptions {{"device", yarp::os::Value("controlboardremapper")}};
+    remapperOptions.put("axesNames", yarp::os::Value::makeList(axesNames.toString().c_str()));
+
+    yarp::dev::IMultipleWrapper * iMultipleWrapper;
+    yarp::dev::PolyDriverList drivers;
+
+    for (auto i = 0; i < PARTS.size(); i++)
+    {
+        drivers.push(&partDevices[i], PARTS[i]);
+    }
+
+    if (!robotDevice.open(remapperOptions) || !robotDevice.view(iMultipleWrapper) || !iMultipleWrapper->attachAll(drivers))
+    {
+        yError() << "Failed to open robot device";
+        return false;
+    }
+
+    return true;
 }
 
-bool BodyExecution::checkMotionDone()
+bool BodyExecution::configureParts(int controlMode)
 {
-    std::lock_guard lock(actionMutex);
-    return !isProcessingSetpoints;
+    jointMin.assign(NUM_AXES, 0.0);
+    jointMax.assign(NUM_AXES, 0.0);
+
+    std::array<std::future<bool>, PARTS.size()> configured;
+
+    // one round trip per board and call, but boards are configured concurrently
+    for (auto i = 0; i < PARTS.size(); i++)
+    {
+        configured[i] = std::async(std::launch::async, [this, i, controlMode] {
+            yarp::dev::IControlMode * mode;
+            yarp::dev::IPositionControl * position;
+            yarp::dev::IControlLimits * limits;
+            int axes;
+
+            if (!partDevices[i].view(mode) || !partDevices[i].view(position) || !partDevices[i].view(limits) || !position->getAxes(&axes))
+            {
+                yError() << "Failed to view interfaces of" << PARTS[i];
+                return false;
+            }
+
+            const int expected = PART_OFFSETS[i + 1] - PART_OFFSETS[i];
+
+            if (axes < expected)
+            {
+                yError("Expected %d axes on %s, got %d", expected, PARTS[i], axes);
+                return false;
+            }
+
+            if (axes > expected)
+            {
+                // e.g. an arm with its hand attached, the extra axes follow the named ones and are left alone
+                yarp::dev::IAxisInfo * info;
+
+                if (partDevices[i].view(info))
+                {
+                    for (auto j = 0; j < expected; j++)
+                    {
+                        std::string name;
+
+                        if (info->getAxisName(j, name) && name != AXES[PART_OFFSETS[i] + j])
+                        {
+                            yError("Axis %d of %s is %s, expected %s", j, PARTS[i], name.c_str(), AXES[PART_OFFSETS[i] + j].c_str());
+                            return false;
+                        }
+                    }
+                }
+
+                yWarning("Ignoring %d extra axes of %s", axes - expected, PARTS[i]);
+                axes = expected;
+            }
+
+            for (auto j = 0; j < axes; j++)
+            {
+                // an empty range disables the check for this joint
+                if (!limits->getLimits(j, &jointMin[PART_OFFSETS[i] + j], &jointMax[PART_OFFSETS[i] + j]))
+                {
+                    yWarning("Failed to get limits of joint %d of %s", j, PARTS[i]);
+                    jointMin[PART_OFFSETS[i] + j] = jointMax[PART_OFFSETS[i] + j] = 0.0;
+                }
+            }
+
+            std::vector<int> indices(axes);
+            std::iota(indices.begin(), indices.end(), 0);
+
+            // set once, never switched afterwards
+            if (!mode->setControlModes(axes, indices.data(), std::vector(axes, controlMode).data()))
+            {
+                yError() << "Failed to set control mode of" << PARTS[i];
+                return false;
+            }
+
+            // all joints are unknown yet, hence sent
+            if (!refSpeedShadow.update(axes, indices.data(), std::vector(axes, DEFAULT_REF_SPEED).data(), PART_OFFSETS[i],
+                [position](auto n, auto * joints, auto * speeds) { return position->setRefSpeeds(n, joints, speeds); }))
+            {
+                yError() << "Failed to set reference speeds of" << PARTS[i];
+                return false;
+            }
+
+            if (!refAccelerationShadow.update(axes, indices.data(), std::vector(axes, DEFAULT_REF_ACCELERATION).data(), PART_OFFSETS[i],
+                [position](auto n, auto * joints, auto * accelerations) { return position->setRefAccelerations(n, joints, accelerations); }))
+            {
+                // might not be available in certain implementations, e.g. OpenRAVE
+                yWarning() << "Failed to set reference accelerations of" << PARTS[i];
+            }
+
+            return true;
+        });
+    }
+
+    bool ok = true;
+
+    for (auto & future : configured)
+    {
+        ok &= future.get();
+    }
+
+    return ok;
 }
 
-bool BodyExecution::stop()
+bool BodyExecution::close()
 {
-    yInfo() << "Commanding stop";
+    closing = true;
 
+    if (startupThread.joinable())
     {
-        std::lock_guard lock(actionMutex);
-        currentAction = noAction;
-        currentSetpoints.clear();
-        isProcessingSetpoints = false;
+        startupThread.join();
     }
 
-    if (!iPositionControl->stop())
+    serverPort.close();
+
     {
-        yWarning() << "Failed to stop";
-        return false;
+        std::lock_guard lock(recorderMutex);
+        recorder.reset(); // flushes the log
+    }
+
+    if (controlThread)
+    {
+        controlThread->stop();
+        controlThread.reset();
+    }
+
+    if (streamer)
+    {
+        streamer->stop();
+        streamer.reset();
+    }
+
+    if (eventThread.joinable())
+    {
+        eventThread.join();
+    }
+
+    drainEvents(); // published while stopping
+    statePort.close();
+
+    stateCache.close();
+    robotDevice.close();
+
+    for (auto & device : partDevices)
+    {
+        device.close();
     }
 
     return true;
 }
 
-void BodyExecution::registerSetpoints(const std::string & action, std::initializer_list<setpoints_t> setpoints)
+bool BodyExecution::interruptModule()
 {
-    yInfo() << "Registered new action:" << action;
+    serverPort.interrupt();
+    statePort.interrupt();
 
-    std::lock_guard lock(actionMutex);
-    currentAction = action;
-    currentSetpoints.clear();
-    currentSetpoints.insert(currentSetpoints.end(), setpoints);
-    isProcessingSetpoints = true;
+    if (state != State::Ready)
+    {
+        return true;
+    }
+
+    yInfo() << "Joint state cache served" << stateCache.getServedCount() << "reads from the state streams and" << stateCache.getRefreshedCount() << "through the remapper";
+
+    std::array<int, NUM_AXES> indices;
+    std::iota(indices.begin(), indices.end(), 0);
+
+    joints_t refSpeeds;
+    refSpeeds.fill(DEFAULT_REF_SPEED);
+
+    if (!refSpeedShadow.update(NUM_AXES, indices.data(), refSpeeds.data(), 0, [this](auto n, auto * joints, auto * speeds) {
+            return iPositionControl->setRefSpeeds(n, joints, speeds);
+        }))
+    {
+        yWarning() << "Failed to restore reference speeds";
+    }
+
+    for (const auto & [key, value] : getSuppressionCounters())
+    {
+        yInfo() << "Reference cache:" << key << value;
+    }
+
+    return stop();
+}
+
+double BodyExecution::getPeriod()
+{
+    return 0.1; // [s]
+}
+
+bool BodyExecution::updateModule()
+{
+    if (state == State::Failed)
+    {
+        yError() << "Startup failed";
+        return false;
+    }
+
+    if (state == State::WarmingUp)
+    {
+        yDebugThrottle(1.0) << "Warming up";
+        return true;
+    }
+
+    if (controlThread)
+    {
+        auto stats = controlThread->getStatistics();
+
+        yDebugThrottle(5.0, "Control thread: %u cycles, %u overruns, jitter %.3f/%.3f ms (mean/max), used %.3f/%.3f ms (mean/max)",
+                       stats.cycles, stats.overruns, stats.meanJitter * 1e3, stats.maxJitter * 1e3, stats.meanUsed * 1e3, stats.maxUsed * 1e3);
+    }
+    else
+    {
+        controlStep();
+    }
+
+    return true;
+}
+
+void BodyExecution::step()
+{
+    if (state != State::Ready)
+    {
+        return;
+    }
+
+    if (streamer)
+    {
+        streamer->step();
+    }
+    else
+    {
+        controlStep();
+    }
+}
+
+void BodyExecution::controlStep()
+{
+    if (streamer)
+    {
+        return; // the streamer handles its own commands
+    }
+
+    ActionCommand command;
+
+    while (commands.pop(command))
+    {
+        if (command.type == ActionCommand::Type::Stop)
+        {
+            abortActions();
+
+            if (!iPositionControl->stop()) // once again, in case a waypoint was sent meanwhile
+            {
+                yWarning() << "Failed to stop";
+            }
+        }
+        else
+        {
+            takenActionId = command.id;
+
+            if (command.policy == ActionCommand::Policy::Replace)
+            {
+                abortActions();
+                startAction(command);
+            }
+            else if (!currentAction)
+            {
+                startAction(command);
+            }
+            else
+            {
+                pendingActions.push_back(command); // blending is not supported in position mode, just enqueue
+            }
+        }
+
+        status = {takenActionId, currentAction ? finishedActionId : takenActionId};
+    }
+
+    bool isMotionDone = true;
+
+    if (currentAction && !iPositionControl->checkMotionDone(&isMotionDone))
+    {
+        yWarning() << "Unable to check motion state";
+    }
+
+    if (currentAction && isMotionDone && nextWaypoint == currentAction->size)
+    {
+        publishEvent("waypoint", currentAction, currentActionId, nextWaypoint - 1);
+        publishEvent("done", currentAction, currentActionId);
+        finishedActionId = currentActionId;
+        currentAction = nullptr; // motion done and no more points to send
+
+        if (!pendingActions.empty())
+        {
+            startAction(pendingActions.front()); // back to back, first waypoint is sent right away
+            pendingActions.pop_front();
+        }
+
+        status = {takenActionId, currentAction ? finishedActionId : takenActionId};
+    }
+
+    yDebugThrottle(1.0) << "Current action:" << (currentAction ? currentAction->name : noAction);
+
+    if (currentAction && isMotionDone && nextWaypoint < currentAction->size)
+    {
+        if (nextWaypoint != 0)
+        {
+            publishEvent("waypoint", currentAction, currentActionId, nextWaypoint - 1);
+        }
+
+        const auto * waypoint = currentAction->waypoint(nextWaypoint, NUM_AXES);
+        bool isFirstWaypoint = nextWaypoint == 0;
+
+        nextWaypoint++;
+
+        joints_t targets;
+        std::copy(waypoint, waypoint + NUM_AXES, targets.begin());
+
+        // the approach is planned from the current position, then follow the precomputed profiles
+        bool ok = isFirstWaypoint ? sendMotionCommand(targets)
+                                  : sendMotionCommand(targets, currentAction->waypoint(nextWaypoint - 2, NUM_AXES),
+                                                      &currentTrajectory->segments[nextWaypoint - 2].profile);
+
+        if (!ok)
+        {
+            yWarning() << "Failed to send new setpoints";
+        }
+        else if (isFirstWaypoint)
+        {
+            publishEvent("moving", currentAction, currentActionId);
+        }
+    }
+}
+
+void BodyExecution::startAction(const ActionCommand & command)
+{
+    currentAction = command.action;
+    currentTrajectory = command.trajectory;
+    currentActionId = command.id;
+    nextWaypoint = 0;
+}
+
+void BodyExecution::abortActions()
+{
+    if (currentAction)
+    {
+        publishEvent("aborted", currentAction, currentActionId);
+        finishedActionId = currentActionId;
+        currentAction = nullptr;
+    }
+
+    for (const auto & command : pendingActions)
+    {
+        publishEvent("aborted", command.action, command.id);
+        finishedActionId = command.id;
+    }
+
+    pendingActions.clear();
+}
+
+bool BodyExecution::sendMotionCommand(const joints_t & targets, const double * q0, const TrajectoryPlanner::Profile * planned)
+{
+    joints_t q;
+    TrajectoryPlanner::Profile profile;
+
+    if (planned && planned->getPeakAcceleration() != 0.0)
+    {
+        // precomputed from the previous waypoint, which the robot stopped at
+        std::copy(q0, q0 + NUM_AXES, q.begin());
+        profile = *planned;
+    }
+    else
+    {
+        if (!stateCache.getEncoders(q.data()))
+        {
+            yWarning() << "Failed to get current encoder values";
+            return false;
+        }
+
+        profile = planner.plan(q.data(), targets.data());
+
+        // densely sampled paths are timed, never go faster than that
+        if (planned && profile.getDuration() != 0.0 && profile.getDuration() < planned->getDuration())
+        {
+            profile = profile.stretch(planned->getDuration());
+        }
+    }
+
+    if (profile.getDuration() != 0.0)
+    {
+        // fixed capacity, only the first n elements are sent
+        std::array<int, NUM_AXES> indices;
+        joints_t refSpeeds;
+        joints_t refAccelerations;
+        joints_t groupTargets;
+
+        int n = planner.getReferences(profile, q.data(), targets.data(), indices.data(), refSpeeds.data(), refAccelerations.data(), groupTargets.data());
+
+        if (dispatchPool)
+        {
+            return dispatchToParts(n, indices.data(), refSpeeds.data(), refAccelerations.data(), groupTargets.data());
+        }
+
+        if (!refSpeedShadow.update(n, indices.data(), refSpeeds.data(), 0, [this](auto m, auto * joints, auto * speeds) {
+                return iPositionControl->setRefSpeeds(m, joints, speeds);
+            }))
+        {
+            yWarning() << "Failed to set reference speeds";
+            return false;
+        }
+
+        if (!refAccelerationShadow.update(n, indices.data(), refAccelerations.data(), 0, [this](auto m, auto * joints, auto * accelerations) {
+                return iPositionControl->setRefAccelerations(m, joints, accelerations);
+            }))
+        {
+            yDebug() << "Failed to set reference accelerations"; // see configureParts()
+        }
+
+        if (!iPositionControl->positionMove(n, indices.data(), groupTargets.data()))
+        {
+            yWarning() << "Failed to send motion command";
+            return false;
+        }
+    }
+    else
+    {
+        yWarning() << "No motion to perform, already on target";
+    }
+
+    return true;
+}
+
+void BodyExecution::doGreet()
+{
+    registerAction("greet");
+}
+
+void BodyExecution::doHoming()
+{
+    registerAction("homing");
+}
+
+void BodyExecution::doExplanation1()
+{
+    registerAction("explanation1");
+}
+
+void BodyExecution::doExplanation2()
+{
+    registerAction("explanation2");
+}
+
+void BodyExecution::doExplanation3()
+{
+    registerAction("explanation3");
+}
+
+void BodyExecution::doExplanation4()
+{
+    registerAction("explanation4");
+}
+
+void BodyExecution::doExplanationHead()
+{
+    registerAction("explanationHead");
+}
+
+void BodyExecution::doExplanationRightPC()
+{
+    registerAction("explanationRightPC");
+}
+
+void BodyExecution::doExplanationLeftPC()
+{
+    registerAction("explanationLeftPC");
+}
+
+void BodyExecution::doExplanationInsidePC()
+{
+    registerAction("explanationInsidePC");
+}
+
+void BodyExecution::doExplanationSensors()
+{
+    registerAction("explanationSensors");
+}
+
+std::int32_t BodyExecution::doAction(const std::string & action, ActionPolicy policy)
+{
+    ActionCommand::Policy commandPolicy;
+    return toCommandPolicy(policy, commandPolicy) ? registerAction(action, commandPolicy) : 0;
+}
+
+std::int32_t BodyExecution::doReplay(const std::string & name, ActionPolicy policy)
+{
+    ActionCommand::Policy commandPolicy;
+
+    if (!toCommandPolicy(policy, commandPolicy))
+    {
+        return 0;
+    }
+
+    if (state != State::Ready)
+    {
+        yWarning() << "Still warming up, rejecting replay";
+        return 0;
+    }
+
+    if (!streamer)
+    {
+        yWarning() << "Replay requires streaming mode (--streaming)";
+        return 0;
+    }
+
+    if (!isLogName(name))
+    {
+        yWarning() << "Illegal joint log name:" << name;
+        return 0;
+    }
+
+    const auto path = recordDir + "/" + name;
+    std::vector<double> waypoints;
+    std::vector<double> durations;
+
+    if (!JointRecorder::load(path, NUM_AXES, waypoints, durations))
+    {
+        return 0;
+    }
+
+    // samples within the same tick would be a step, keep the latest one
+    std::size_t kept = 1;
+
+    for (auto k = 1; k < waypoints.size() / NUM_AXES; k++)
+    {
+        if (durations[k - 1] > 0.0)
+        {
+            durations[kept - 1] = durations[k - 1];
+            kept++;
+        }
+
+        // otherwise, overwrite the previous sample
+        std::copy(waypoints.cbegin() + k * NUM_AXES, waypoints.cbegin() + (k + 1) * NUM_AXES, waypoints.begin() + (kept - 1) * NUM_AXES);
+    }
+
+    waypoints.resize(kept * NUM_AXES);
+    durations.resize(kept - 1);
+
+    const auto & limits = planner.getLimits();
+
+    for (auto k = 1; k < kept; k++)
+    {
+        for (auto i = 0; i < NUM_AXES; i++)
+        {
+            auto speed = std::abs(waypoints[k * NUM_AXES + i] - waypoints[(k - 1) * NUM_AXES + i]) / durations[k - 1];
+
+            if (speed > limits.maxSpeed[i] * (1.0 + 1e-6))
+            {
+                yWarning("Segment %d of joint log is too fast for %s: %f deg/s, max %f deg/s", k, library.getAxes()[i].c_str(), speed, limits.maxSpeed[i]);
+                return 0;
+            }
+        }
+    }
+
+    std::string reason;
+
+    if (!validator.check({replayedAction, waypoints.data(), waypoints.size() / NUM_AXES}, library.getAxes(), reason))
+    {
+        yWarning() << "Joint log failed validation:" << reason;
+        return 0;
+    }
+
+    std::lock_guard lock(uploadMutex);
+    auto * upload = acquireUpload();
+
+    if (!upload)
+    {
+        return 0;
+    }
+
+    upload->waypoints = std::move(waypoints);
+    upload->action = {replayedAction, upload->waypoints.data(), upload->waypoints.size() / NUM_AXES};
+    std::vector<TrajectoryPlanner::Profile> profiles;
+
+    // samples are dense, just interpolate linearly between them at the recorded pace
+    for (auto duration : durations)
+    {
+        profiles.push_back(TrajectoryPlanner::Profile::linear(duration));
+    }
+
+    upload->trajectory = TrajectoryPlanner::Trajectory::fromProfiles(std::move(profiles), NUM_AXES);
+    upload->id = enqueueAction(&upload->action, commandPolicy, &upload->trajectory);
+
+    if (upload->id != 0)
+    {
+        yInfo() << "Replaying" << upload->action.size << "samples from" << path << "with id" << upload->id;
+    }
+
+    return upload->id;
+}
+
+bool BodyExecution::startRecording(const std::string & name)
+{
+    if (state != State::Ready)
+    {
+        yWarning() << "Still warming up, unable to record";
+        return false;
+    }
+
+    if (!isLogName(name))
+    {
+        yWarning() << "Illegal joint log name:" << name;
+        return false;
+    }
+
+    if (yarp::os::mkdir_p(recordDir.c_str(), 0) != 0)
+    {
+        yWarning() << "Unable to create directory" << recordDir;
+        return false;
+    }
+
+    const auto path = recordDir + "/" + name;
+
+    std::lock_guard lock(recorderMutex);
+
+    if (recorder)
+    {
+        yWarning() << "Already recording";
+        return false;
+    }
+
+    recorder = std::make_unique<JointRecorder>(recordPeriod, stateCache, NUM_AXES);
+
+    if (!recorder->open(path))
+    {
+        recorder.reset();
+        return false;
+    }
+
+    yInfo() << "Recording joint positions to" << path;
+    return true;
+}
+
+bool BodyExecution::stopRecording()
+{
+    std::lock_guard lock(recorderMutex);
+
+    if (!recorder)
+    {
+        yWarning() << "Not recording";
+        return false;
+    }
+
+    recorder->close();
+    yInfo() << "Recorded" << recorder->getRecordedCount() << "samples, dropped" << recorder->getDroppedCount();
+    recorder.reset();
+    return true;
+}
+
+BodyExecution::Upload * BodyExecution::acquireUpload()
+{
+    auto current = streamer ? streamer->getStatus() : status.load();
+
+    // the last finished action might still be referenced by the control loop in this very cycle
+    auto upload = std::find_if(uploads.begin(), uploads.end(), [&current](const auto & slot) {
+        return slot.id == 0 || slot.id < current.finished;
+    });
+
+    if (upload == uploads.end())
+    {
+        yWarning() << "Too many trajectories in progress, rejecting new one, max:" << MAX_UPLOADS;
+        return nullptr;
+    }
+
+    return &*upload;
+}
+
+std::int32_t BodyExecution::doTrajectory(const std::string & waypoints, const std::string & durations, ActionPolicy policy)
+{
+    ActionCommand::Policy commandPolicy;
+
+    if (!toCommandPolicy(policy, commandPolicy))
+    {
+        return 0;
+    }
+
+    if (state != State::Ready)
+    {
+        yWarning() << "Still warming up, rejecting trajectory";
+        return 0;
+    }
+
+    constexpr auto waypointSize = NUM_AXES * sizeof(double);
+
+    if (waypoints.empty() || waypoints.size() % waypointSize != 0)
+    {
+        yWarning("Illegal trajectory size: %zu bytes, expected a multiple of %zu (%zu doubles per waypoint)", waypoints.size(), waypointSize, NUM_AXES);
+        return 0;
+    }
+
+    const std::size_t size = waypoints.size() / waypointSize;
+
+    if (!durations.empty() && durations.size() != (size - 1) * sizeof(double))
+    {
+        yWarning("Illegal timing size: %zu bytes, expected none or %zu (one double per segment)", durations.size(), (size - 1) * sizeof(double));
+        return 0;
+    }
+
+    std::lock_guard lock(uploadMutex);
+    auto * upload = acquireUpload();
+
+    if (!upload)
+    {
+        return 0;
+    }
+
+    // copy, the blob is not guaranteed to be aligned
+    upload->waypoints.resize(size * NUM_AXES);
+    std::memcpy(upload->waypoints.data(), waypoints.data(), waypoints.size());
+
+    if (!std::all_of(upload->waypoints.cbegin(), upload->waypoints.cend(), [](auto q) { return std::isfinite(q); }))
+    {
+        yWarning() << "Trajectory contains non-finite joint positions";
+        return 0;
+    }
+
+    std::vector<double> times(durations.size() / sizeof(double));
+
+    if (!times.empty())
+    {
+        std::memcpy(times.data(), durations.data(), durations.size());
+    }
+
+    upload->action = {uploadedAction, upload->waypoints.data(), size};
+    std::vector<TrajectoryPlanner::Profile> profiles;
+
+    for (auto k = 1; k < size; k++)
+    {
+        auto profile = planner.plan(upload->action.waypoint(k - 1, NUM_AXES), upload->action.waypoint(k, NUM_AXES));
+
+        if (!times.empty())
+        {
+            // some tolerance for timings computed offline with the same limits
+            if (!std::isfinite(times[k - 1]) || times[k - 1] < profile.getDuration() - 1e-6)
+            {
+                yWarning("Segment %d of trajectory is too fast: %f s requested, %f s at least", k, times[k - 1], profile.getDuration());
+                return 0;
+            }
+
+            profile = profile.stretch(std::max(times[k - 1], profile.getDuration()));
+        }
+
+        profiles.push_back(profile);
+    }
+
+    upload->trajectory = TrajectoryPlanner::Trajectory::fromProfiles(std::move(profiles), NUM_AXES);
+
+    std::string reason;
+
+    if (!validator.check(upload->action, library.getAxes(), reason))
+    {
+        yWarning() << "Trajectory failed validation:" << reason;
+        return 0;
+    }
+
+    upload->id = enqueueAction(&upload->action, commandPolicy, &upload->trajectory);
+
+    if (upload->id != 0)
+    {
+        yInfo() << "Registered trajectory of" << size << "waypoints with id" << upload->id;
+    }
+
+    return upload->id;
+}
+
+bool BodyExecution::checkMotionDone()
+{
+    if (state != State::Ready)
+    {
+        return true; // no action was accepted
+    }
+
+    // done once every request has completed, including those still queued or dropped
+    int requested = requestedActionId;
+
+    for (int id = std::max(1, requested - static_cast<int>(FINISHED_IDS) + 1); id <= requested; id++)
+    {
+        if (!isActionFinished(id))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BodyExecution::checkActionDone(std::int32_t id)
+{
+    if (id <= 0 || id > requestedActionId)
+    {
+        yWarning() << "Unknown action id:" << id;
+        return true; // nothing to wait for
+    }
+
+    if (state != State::Ready)
+    {
+        return true;
+    }
+
+    return isActionFinished(id);
+}
+
+DurationEstimate BodyExecution::estimateDuration(const std::string & action)
+{
+    const auto * found = state == State::Ready ? library.find(action) : nullptr;
+
+    if (!found)
+    {
+        yWarning() << "Unknown action:" << action;
+        DurationEstimate unknown;
+        unknown.action = action;
+        unknown.total = -1.0;
+        return unknown;
+    }
+
+    joints_t q;
+
+    if (!stateCache.getEncoders(q.data()))
+    {
+        yWarning() << "Failed to get current encoder values, assuming the robot rests at the first waypoint";
+        std::copy(found->waypoints, found->waypoints + NUM_AXES, q.begin());
+    }
+
+    return estimate(found, q);
+}
+
+std::vector<DurationEstimate> BodyExecution::estimateDurations()
+{
+    if (state != State::Ready)
+    {
+        yWarning() << "Still warming up";
+        return {};
+    }
+
+    joints_t q;
+    bool hasEncoders = stateCache.getEncoders(q.data());
+
+    if (!hasEncoders)
+    {
+        yWarning() << "Failed to get current encoder values, assuming the robot rests at the first waypoint";
+    }
+
+    std::vector<DurationEstimate> estimates;
+    estimates.reserve(library.getNumActions());
+
+    for (const auto & action : library.getActions())
+    {
+        if (!hasEncoders)
+        {
+            std::copy(action.waypoints, action.waypoints + NUM_AXES, q.begin());
+        }
+
+        estimates.push_back(estimate(&action, q));
+    }
+
+    return estimates;
+}
+
+DurationEstimate BodyExecution::estimate(const MotionLibrary::Action * action, const joints_t & q) const
+{
+    // approach from the given state, then the precomputed trajectory (no blending nor controller delays)
+    DurationEstimate result;
+    result.action = action->name;
+    result.waypoints.reserve(action->size);
+    result.waypoints.push_back(planner.plan(q.data(), action->waypoint(0, NUM_AXES)).getDuration());
+
+    // position mode stops at each waypoint
+    for (const auto & segment : planner.find(action->name)->segments)
+    {
+        result.waypoints.push_back(streamer ? segment.duration : segment.profile.getDuration());
+    }
+
+    result.total = 0.0;
+
+    for (auto duration : result.waypoints)
+    {
+        result.total += duration;
+    }
+
+    return result;
+}
+
+bool BodyExecution::dispatchToParts(int n, const int * indices, const double * refSpeeds, const double * refAccelerations, const double * targets)
+{
+    // indices are sorted, hence each part owns a contiguous range of the group command
+    std::array<int, NUM_AXES> localIndices;
+    std::array<int, PARTS.size()> begin;
+    std::array<int, PARTS.size()> end;
+
+    for (auto p = 0, k = 0; p < PARTS.size(); p++)
+    {
+        begin[p] = k;
+
+        while (k < n && indices[k] < PART_OFFSETS[p + 1])
+        {
+            localIndices[k] = indices[k] - PART_OFFSETS[p];
+            k++;
+        }
+
+        end[p] = k;
+    }
+
+    std::array<bool, PARTS.size()> ok;
+    ok.fill(true);
+
+    dispatchPool->run(PARTS.size(), [&](std::size_t p) {
+        if (begin[p] == end[p])
+        {
+            return;
+        }
+
+        const auto b = begin[p];
+        const auto size = end[p] - b;
+
+        auto * position = partPositionControls[p];
+
+        ok[p] = refSpeedShadow.update(size, localIndices.data() + b, refSpeeds + b, PART_OFFSETS[p], [position](auto m, auto * joints, auto * speeds) {
+            return position->setRefSpeeds(m, joints, speeds);
+        });
+
+        if (!refAccelerationShadow.update(size, localIndices.data() + b, refAccelerations + b, PART_OFFSETS[p], [position](auto m, auto * joints, auto * accelerations) {
+                return position->setRefAccelerations(m, joints, accelerations);
+            }))
+        {
+            yDebug() << "Failed to set reference accelerations of" << PARTS[p]; // see configureParts()
+        }
+    });
+
+    for (auto p = 0; p < PARTS.size(); p++)
+    {
+        if (!ok[p])
+        {
+            yWarning() << "Failed to set reference speeds of" << PARTS[p];
+            return false;
+        }
+    }
+
+    // common start, the skew between parts is measured as each command is dispatched
+    const auto startAt = yarp::os::SystemClock::nowSystem() + DISPATCH_LEAD;
+    std::array<double, PARTS.size()> sent;
+
+    dispatchPool->run(PARTS.size(), [&](std::size_t p) {
+        if (begin[p] == end[p])
+        {
+            return;
+        }
+
+        while (yarp::os::SystemClock::nowSystem() < startAt)
+        {
+            std::this_thread::yield();
+        }
+
+        const auto b = begin[p];
+        sent[p] = yarp::os::SystemClock::nowSystem();
+        ok[p] = partPositionControls[p]->positionMove(end[p] - b, localIndices.data() + b, targets + b);
+    });
+
+    double first = std::numeric_limits<double>::infinity();
+    double last = -first;
+    int moved = 0;
+
+    for (auto p = 0; p < PARTS.size(); p++)
+    {
+        if (begin[p] == end[p])
+        {
+            continue;
+        }
+
+        if (!ok[p])
+        {
+            yWarning() << "Failed to send motion command to" << PARTS[p];
+            return false;
+        }
+
+        first = std::min(first, sent[p]);
+        last = std::max(last, sent[p]);
+        moved++;
+    }
+
+    if (moved > 1)
+    {
+        dispatchSkew.record(currentAction ? currentAction->name : noAction, "part_start_skew", last - first); // no allocation once seen
+    }
+
+    return true;
+}
+
+std::map<std::string, std::int32_t> BodyExecution::getSuppressionCounters()
+{
+    return {
+        {"ref_speed_calls", refSpeedShadow.getSentCalls()},
+        {"ref_speed_suppressed_calls", refSpeedShadow.getSuppressedCalls()},
+        {"ref_speed_suppressed_joints", refSpeedShadow.getSuppressedJoints()},
+        {"ref_acceleration_calls", refAccelerationShadow.getSentCalls()},
+        {"ref_acceleration_suppressed_calls", refAccelerationShadow.getSuppressedCalls()},
+        {"ref_acceleration_suppressed_joints", refAccelerationShadow.getSuppressedJoints()}
+    };
+}
+
+std::vector<LatencyHistogram> BodyExecution::getStats()
+{
+    auto histograms = latencies.getHistograms();
+    auto skew = dispatchSkew.getHistograms();
+    histograms.insert(histograms.end(), skew.cbegin(), skew.cend());
+    return histograms;
+}
+
+bool BodyExecution::resetStats()
+{
+    {
+        std::lock_guard lock(statePortMutex);
+        timedActionId = 0; // an action in progress would be only partially timed
+    }
+
+    latencies.clear();
+    dispatchSkew.clear();
+    return true;
+}
+
+std::string BodyExecution::getStartupState()
+{
+    switch (state)
+    {
+    case State::WarmingUp:
+        return "warming up";
+    case State::Ready:
+        return "ready";
+    default:
+        return "failed";
+    }
+}
+
+bool BodyExecution::stop()
+{
+    yInfo() << "Commanding stop";
+
+    if (state != State::Ready)
+    {
+        return true; // nothing to stop
+    }
+
+    if (streamer)
+    {
+        return streamer->abort(); // hold the last streamed reference
+    }
+
+    bool ok = iPositionControl->stop(); // don't wait for the control loop
+
+    if (!ok)
+    {
+        yWarning() << "Failed to stop";
+    }
+
+    if (!commands.push({ActionCommand::Type::Stop}))
+    {
+        yWarning() << "Command queue is full, unable to discard current action";
+        return false;
+    }
+
+    return ok;
+}
+
+bool BodyExecution::loadLibrary(const std::string & path)
+{
+    auto start = yarp::os::SystemClock::nowSystem();
+    bool isCompiled = path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+
+    if (!(isCompiled ? library.fromBinaryFile(path) : library.fromConfigFile(path)))
+    {
+        yError() << "Failed to load motion library from" << path;
+        return false;
+    }
+
+    yInfo("Loaded %zu actions from %s motion library %s in %.3f ms", library.getNumActions(),
+          isCompiled ? "compiled" : "text", path.c_str(), (yarp::os::SystemClock::nowSystem() - start) * 1e3);
+
+    return true;
+}
+
+bool BodyExecution::loadLimits(const std::string & path)
+{
+    TrajectoryPlanner::Limits limits {
+        std::vector(library.getNumAxes(), DEFAULT_REF_SPEED),
+        std::vector(library.getNumAxes(), DEFAULT_REF_ACCELERATION),
+        std::vector(library.getNumAxes(), DEFAULT_MAX_JERK)
+    };
+
+    yarp::os::Property config;
+
+    if (path.empty() || !config.fromConfigFile(path))
+    {
+        yWarning() << "Joint limits file not found, using default limits for all axes";
+    }
+    else
+    {
+        const std::vector<std::pair<std::string, std::vector<double> *>> keys {
+            {"speed", &limits.maxSpeed},
+            {"acceleration", &limits.maxAcceleration},
+            {"jerk", &limits.maxJerk}
+        };
+
+        for (const auto & [key, values] : keys)
+        {
+            const auto * list = config.find(key).asList();
+
+            if (!list)
+            {
+                continue; // keep defaults
+            }
+
+            if (list->size() != values->size())
+            {
+                yError("Expected %zu %s limits in %s, got %zu", values->size(), key.c_str(), path.c_str(), list->size());
+                return false;
+            }
+
+            for (auto i = 0; i < list->size(); i++)
+            {
+                (*values)[i] = list->get(i).asFloat64();
+            }
+        }
+    }
+
+    auto start = yarp::os::SystemClock::nowSystem();
+
+    if (!planner.configure(library, limits))
+    {
+        yError() << "Failed to plan trajectories of the motion library";
+        return false;
+    }
+
+    yInfo("Planned trajectories of %zu actions in %.3f ms", library.getNumActions(), (yarp::os::SystemClock::nowSystem() - start) * 1e3);
+    return true;
+}
+
+bool BodyExecution::validateLibrary(const std::string & kinematics, const std::string & cache, bool streaming)
+{
+    validator.setLimits(jointMin, jointMax);
+
+    if (kinematics.empty())
+    {
+        yWarning() << "No kinematic model, checking joint limits only";
+    }
+    else if (!validator.loadKinematics(kinematics, library.getNumAxes()))
+    {
+        yWarning() << "Failed to load kinematic model from" << kinematics << "- checking joint limits only";
+    }
+
+    auto start = yarp::os::SystemClock::nowSystem();
+    const auto & actions = library.getActions();
+    rejectedActions.assign(actions.size(), false);
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(validator.getFingerprint(library, streaming ? &planner : nullptr)));
+
+    // first line: fingerprint, then one line per rejected action: name<TAB>reason
+    std::vector<std::pair<std::string, std::string>> rejections;
+    std::ifstream in(cache);
+    std::string line;
+    bool isCached = in && std::getline(in, line) && line == key;
+
+    if (isCached)
+    {
+        while (std::getline(in, line))
+        {
+            auto tab = line.find('\t');
+
+            if (tab != std::string::npos)
+            {
+                rejections.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+            }
+        }
+    }
+    else
+    {
+        for (const auto & action : actions)
+        {
+            std::string reason;
+
+            // only the streamer crosses waypoints along the blended segments, position mode stops at each one
+            if (!validator.check(action, library.getAxes(), reason, streaming ? planner.find(action.name) : nullptr))
+            {
+                rejections.emplace_back(action.name, reason);
+            }
+        }
+
+        auto slash = cache.find_last_of('/');
+
+        if (slash != std::string::npos && slash != 0)
+        {
+            yarp::os::mkdir_p(cache.substr(0, slash).c_str());
+        }
+
+        std::ofstream out(cache, std::ios::trunc);
+        out << key << '\n';
+
+        for (const auto & [name, reason] : rejections)
+        {
+            out << name << '\t' << reason << '\n';
+        }
+
+        if (!out)
+        {
+            yWarning() << "Unable to write validation cache to" << cache;
+        }
+    }
+
+    for (const auto & [name, reason] : rejections)
+    {
+        auto found = std::find_if(actions.begin(), actions.end(), [&name = name](const auto & action) { return action.name == name; });
+
+        if (found != actions.end())
+        {
+            rejectedActions[found - actions.begin()] = true;
+            yWarning() << "Action" << name << "failed validation:" << reason;
+        }
+    }
+
+    yInfo("Validated %zu actions in %.3f ms (%s), %zu rejected", actions.size(), (yarp::os::SystemClock::nowSystem() - start) * 1e3,
+          isCached ? "cached" : validator.hasKinematics() ? "limits and self-collision" : "limits", rejections.size());
+
+    return true;
+}
+
+int BodyExecution::registerAction(std::string_view action, ActionCommand::Policy policy)
+{
+    if (state != State::Ready)
+    {
+        yWarning() << "Still warming up, rejecting action:" << action;
+        return 0;
+    }
+
+    const auto * found = library.find(action);
+
+    if (!found)
+    {
+        yWarning() << "Unknown action:" << action;
+        return 0;
+    }
+
+    if (rejectedActions[found - library.getActions().data()])
+    {
+        yWarning() << "Action failed validation, rejecting:" << action;
+        return 0;
+    }
+
+    int id = enqueueAction(found, policy, planner.find(action));
+
+    if (id != 0)
+    {
+        yInfo() << "Registered new action:" << action << "with id" << id;
+    }
+
+    return id;
+}
+
+int BodyExecution::enqueueAction(const MotionLibrary::Action * action, ActionCommand::Policy policy, const TrajectoryPlanner::Trajectory * trajectory)
+{
+    int id = requestedActionId;
+
+    do
+    {
+        // the slot of the new id must be free, hence at most FINISHED_IDS actions in flight
+        if (id >= static_cast<int>(FINISHED_IDS) && !isActionFinished(id + 1 - static_cast<int>(FINISHED_IDS)))
+        {
+            yWarning() << "Too many actions in flight, rejecting action:" << action->name;
+            return 0;
+        }
+    }
+    while (!requestedActionId.compare_exchange_weak(id, id + 1));
+
+    id++;
+    publishEvent("started", action, id);
+
+    if (!(streamer ? streamer->execute(action, id, policy, trajectory) : commands.push({ActionCommand::Type::Execute, action, id, policy, trajectory})))
+    {
+        yWarning() << "Command queue is full, dropping action:" << action->name;
+        publishEvent("rejected", action, id); // never reaches the control loop, the caller gets no id
+        return 0;
+    }
+
+    return id;
+}
+
+bool BodyExecution::isActionFinished(int id) const
+{
+    // enqueueAction never reuses the slot of an unfinished id, hence older ids are done
+    return finishedIds[id % FINISHED_IDS] == id || requestedActionId - id >= static_cast<int>(FINISHED_IDS);
+}
+
+void BodyExecution::publishEvent(std::string_view event, const MotionLibrary::Action * action, int id, int waypoint)
+{
+    // called from the control loop, must not block
+    if (event == "done" || event == "aborted" || event == "rejected")
+    {
+        finishedIds[id % FINISHED_IDS] = id;
+    }
+
+    if (!events.push({event, action->name, id, waypoint, yarp::os::SystemClock::nowSystem()}))
+    {
+        droppedEvents++;
+    }
+}
+
+void BodyExecution::publishEvents()
+{
+    while (!closing)
+    {
+        drainEvents();
+        yarp::os::SystemClock::delaySystem(EVENT_POLL_PERIOD);
+    }
+}
+
+void BodyExecution::drainEvents()
+{
+    Event event;
+
+    while (events.pop(event))
+    {
+        std::lock_guard lock(statePortMutex);
+
+        if (event.type == "started")
+        {
+            timedActionId = event.id;
+            actionReceived = lastActionEvent = event.timestamp;
+        }
+        else if (event.id == timedActionId)
+        {
+            std::string key(event.action);
+
+            if (event.type == "moving")
+            {
+                latencies.record(key, "received_to_first_command", event.timestamp - actionReceived);
+            }
+            else if (event.type == "waypoint")
+            {
+                latencies.record(key, "waypoint_" + std::to_string(event.waypoint), event.timestamp - lastActionEvent);
+            }
+            else if (event.type == "done")
+            {
+                latencies.record(key, "received_to_done", event.timestamp - actionReceived);
+            }
+
+            lastActionEvent = event.timestamp;
+        }
+
+        auto & bottle = statePort.prepare();
+        bottle.clear();
+        bottle.addString(std::string(event.type));
+        bottle.addString(std::string(event.action));
+        bottle.addInt32(event.id);
+        bottle.addInt32(event.waypoint);
+        bottle.addFloat64(event.timestamp);
+
+        statePort.writeStrict(); // events must not be dropped
+    }
+
+    if (auto dropped = droppedEvents.exchange(0); dropped != 0)
+    {
+        yWarning() << "Event queue is full, dropped" << dropped << "events";
+    }
 }
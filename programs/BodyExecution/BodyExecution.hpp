@@ -4,22 +4,44 @@
 #define __BODY_EXECUTION_HPP__
 
 #include <array>
+#include <atomic>
 #include <deque>
-#include <initializer_list>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
+#include <yarp/os/Bottle.h>
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/RFModule.h>
 #include <yarp/os/RpcServer.h>
 
 #include <yarp/dev/IControlMode.h>
 #include <yarp/dev/IEncoders.h>
 #include <yarp/dev/IPositionControl.h>
+#include <yarp/dev/IPositionDirect.h>
 #include <yarp/dev/PolyDriver.h>
 
 #include "SelfPresentationCommands.h"
 
+#include "LatencyStatistics.hpp"
+
+#include "ActionCommand.hpp"
+#include "ControlThread.hpp"
+#include "JointRecorder.hpp"
+#include "JointStateCache.hpp"
+#include "MotionLibrary.hpp"
+#include "MotionValidator.hpp"
+#include "ReferenceShadow.hpp"
+#include "TrajectoryPlanner.hpp"
+#include "TrajectoryStreamer.hpp"
+#include "WorkerPool.hpp"
+
 namespace roboticslab
 {
 
@@ -35,10 +57,24 @@ public:
     using setpoints_arm_t = std::array<double, 6>;
     using setpoints_t = std::tuple<setpoints_head_t, setpoints_arm_t, setpoints_arm_t>;
 
+    static constexpr std::size_t NUM_AXES = std::apply([](auto... parts) {
+        return (std::tuple_size_v<decltype(parts)> + ...);
+    }, setpoints_t{});
+
+    using joints_t = std::array<double, NUM_AXES>; // flattened setpoints_t
+
+    //! Local port prefix, hosted instances append the robot name to it.
+    static constexpr auto DEFAULT_PREFIX = "/bodyExecution";
+
     ~BodyExecution()
     { close(); }
 
     bool configure(yarp::os::ResourceFinder & rf) override;
+
+    //! Configure as one of many instances in the same process, the host calls step() periodically.
+    bool configureHosted(yarp::os::ResourceFinder & rf, const std::string & robot, const std::string & prefix, double period);
+    void step();
+
     bool close() override;
     bool interruptModule() override;
     double getPeriod() override;
@@ -55,26 +91,167 @@ public:
     void doExplanationLeftPC() override;
     void doExplanationInsidePC() override;
     void doExplanationSensors() override;
+    std::int32_t doAction(const std::string & action, ActionPolicy policy) override;
+    std::int32_t doTrajectory(const std::string & waypoints, const std::string & durations, ActionPolicy policy) override;
+    std::int32_t doReplay(const std::string & name, ActionPolicy policy) override;
+    bool startRecording(const std::string & name) override;
+    bool stopRecording() override;
     bool checkMotionDone() override;
+    std::string getStartupState() override;
+    bool checkActionDone(std::int32_t id) override;
+    DurationEstimate estimateDuration(const std::string & action) override;
+    std::vector<DurationEstimate> estimateDurations() override;
     bool stop() override;
+    std::vector<LatencyHistogram> getStats() override;
+    bool resetStats() override;
+    std::map<std::string, std::int32_t> getSuppressionCounters() override;
 
 private:
-    void registerSetpoints(const std::string & action, std::initializer_list<setpoints_t> setpoints);
-    bool sendMotionCommand(const std::vector<double> & targets);
+    enum class State { WarmingUp, Ready, Failed };
+
+    struct StartupOptions
+    {
+        std::string robot;
+        std::string prefix;
+        std::string library;
+        std::string limits;
+        double streamingPeriod;
+        double maxStateAge;
+        double timeout;
+        bool streaming;
+        bool isHosted;
+        bool useControlThread;
+        double controlPeriod;
+        int controlPriority;
+        int controlCpu;
+        bool partDispatch;
+        std::string kinematics;
+        std::string validationCache;
+    };
+
+    bool open(yarp::os::ResourceFinder & rf, const std::string & robot, const std::string & prefix, double hostPeriod, const std::string & instance);
+    bool warmUp(const StartupOptions & options);
+    bool openDevices(const std::string & robot, const std::string & prefix, double timeout);
+    bool configureParts(int controlMode);
+    void controlStep();
+    bool loadLibrary(const std::string & path);
+    bool loadLimits(const std::string & path);
+    bool validateLibrary(const std::string & kinematics, const std::string & cache, bool streaming);
+    int registerAction(std::string_view action, ActionCommand::Policy policy = ActionCommand::Policy::Replace);
+    int enqueueAction(const MotionLibrary::Action * action, ActionCommand::Policy policy, const TrajectoryPlanner::Trajectory * trajectory);
+    void startAction(const ActionCommand & command);
+    void abortActions();
+    DurationEstimate estimate(const MotionLibrary::Action * action, const joints_t & q) const;
+    bool sendMotionCommand(const joints_t & targets, const double * q0 = nullptr, const TrajectoryPlanner::Profile * profile = nullptr);
+    bool dispatchToParts(int n, const int * indices, const double * refSpeeds, const double * refAccelerations, const double * targets);
+    void publishEvent(std::string_view event, const MotionLibrary::Action * action, int id, int waypoint = -1);
+    void publishEvents();
+    void drainEvents();
+    bool isActionFinished(int id) const;
+
+    static constexpr std::string_view noAction { "none" };
+    static constexpr std::string_view uploadedAction { "trajectory" };
+    static constexpr std::string_view replayedAction { "replay" };
+    static constexpr std::size_t MAX_UPLOADS = 8;
+    static constexpr std::size_t FINISHED_IDS = 64;
+
+    //! Trajectory received through doTrajectory or doReplay, kept alive until executed or aborted.
+    struct Upload
+    {
+        std::vector<double> waypoints;
+        TrajectoryPlanner::Trajectory trajectory;
+        MotionLibrary::Action action;
+        int id { 0 };
+    };
+
+    Upload * acquireUpload(); // with uploadMutex held
+
+    MotionLibrary library;
+    TrajectoryPlanner planner;
+    MotionValidator validator;
+    std::vector<char> rejectedActions; // indexed as library.getActions(), set once at startup
 
-    const std::string noAction { "none" };
+    //! Lifecycle event of an action, written to the state port by the publisher thread.
+    struct Event
+    {
+        std::string_view type;
+        std::string_view action;
+        std::int32_t id { 0 };
+        std::int32_t waypoint { -1 };
+        double timestamp { 0.0 };
+    };
 
-    std::string currentAction { noAction };
-    std::deque<setpoints_t> currentSetpoints;
-    std::mutex actionMutex;
-    bool isProcessingSetpoints { false };
+    // RPC thread -> control loop (position mode only, the streamer has its own queue)
+    ActionQueue commands;
+    std::atomic<ActionStatus> status { ActionStatus{} };
+    std::atomic<int> requestedActionId { 0 };
 
-    yarp::dev::PolyDriver robotDevice;
+    // ids done, aborted or rejected, indexed by id modulo size, set by whichever thread ends the action
+    std::array<std::atomic<std::int32_t>, FINISHED_IDS> finishedIds {};
+
+    // accessed from the control loop only
+    const MotionLibrary::Action * currentAction { nullptr };
+    const TrajectoryPlanner::Trajectory * currentTrajectory { nullptr };
+    int currentActionId { 0 };
+    std::size_t nextWaypoint { 0 };
+    std::deque<ActionCommand> pendingActions;
+    int takenActionId { 0 };
+    int finishedActionId { 0 };
+
+    // RPC side, a slot is reused once its action is done
+    std::array<Upload, MAX_UPLOADS> uploads;
+    std::mutex uploadMutex;
+
+    std::unique_ptr<JointRecorder> recorder; // null unless recording
+    std::mutex recorderMutex;
+    double recordPeriod { 0.0 };
+    std::string recordDir;
+
+    std::array<yarp::dev::PolyDriver, std::tuple_size_v<setpoints_t>> partDevices;
+    yarp::dev::PolyDriver robotDevice; // remapper over partDevices
     yarp::dev::IControlMode * iControlMode { nullptr };
     yarp::dev::IEncoders * iEncoders { nullptr };
     yarp::dev::IPositionControl * iPositionControl { nullptr };
+    yarp::dev::IPositionDirect * iPositionDirect { nullptr };
+
+    JointStateCache stateCache;
+
+    // as reported by the parts, filled at startup
+    std::vector<double> jointMin;
+    std::vector<double> jointMax;
+
+    // device-side references as last accepted, redundant calls are skipped
+    ReferenceShadow<double, NUM_AXES> refSpeedShadow;
+    ReferenceShadow<double, NUM_AXES> refAccelerationShadow;
+
+    std::unique_ptr<TrajectoryStreamer> streamer; // null unless in streaming mode
+    std::unique_ptr<ControlThread> controlThread; // null if run by the module loop
+
+    // one client per part, bypasses the remapper (position mode only)
+    std::array<yarp::dev::IPositionControl *, std::tuple_size_v<setpoints_t>> partPositionControls {};
+    std::unique_ptr<WorkerPool> dispatchPool; // null unless enabled
+
+    // robot connection and configuration run in the background, RPC port answers meanwhile
+    std::thread startupThread;
+    std::atomic<State> state { State::WarmingUp };
+    std::atomic<bool> closing { false };
+    double startupBegin { 0.0 };
 
     yarp::os::RpcServer serverPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> statePort;
+    std::mutex statePortMutex;
+
+    // any thread -> publisher thread, so that the control loop never waits on the state port
+    CommandQueue<Event, 256> events;
+    std::atomic<unsigned int> droppedEvents { 0 };
+    std::thread eventThread;
+
+    // timing of the latest action, guarded by statePortMutex
+    int timedActionId { 0 };
+    double actionReceived { 0.0 };
+    double lastActionEvent { 0.0 };
+    LatencyStatistics latencies { "bodyExecution", 0.05, 200 }; // [s], up to 10 s
+    LatencyStatistics dispatchSkew { "bodyExecution", 0.0005, 100 }; // [s], up to 50 ms
 };
 
 } // namespace roboticslab
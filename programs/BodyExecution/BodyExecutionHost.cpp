@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "BodyExecutionHost.hpp"
+
+#include <thread>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+
+using namespace roboticslab;
+
+constexpr auto DEFAULT_HOST_PERIOD = 0.02; // [s]
+
+bool BodyExecutionHost::configure(yarp::os::ResourceFinder & rf)
+{
+    const auto * robots = rf.find("robots").asList();
+    auto workers = rf.check("workers", yarp::os::Value(static_cast<int>(std::thread::hardware_concurrency())), "worker threads").asInt32();
+    auto period = rf.check("hostPeriod", yarp::os::Value(DEFAULT_HOST_PERIOD), "host period [s]").asFloat64();
+
+    if (!robots || robots->size() == 0)
+    {
+        yError() << "Missing list of robots to host";
+        return false;
+    }
+
+    if (period <= 0.0)
+    {
+        yError() << "Illegal host period:" << period;
+        return false;
+    }
+
+    for (auto i = 0; i < robots->size(); i++)
+    {
+        auto robot = robots->get(i).asString();
+        auto & instance = instances.emplace_back(std::make_unique<BodyExecution>());
+
+        // e.g. /teoSim1 -> /bodyExecution/teoSim1/rpc:s
+        if (!instance->configureHosted(rf, robot, BodyExecution::DEFAULT_PREFIX + robot, period))
+        {
+            yError() << "Failed to configure instance for robot" << robot;
+            return false;
+        }
+    }
+
+    pool = std::make_unique<WorkerPool>(workers > 0 ? workers : 1);
+
+    yInfo() << "Hosting" << instances.size() << "instances with" << (workers > 0 ? workers : 1) << "worker threads";
+
+    return yarp::os::PeriodicThread::setPeriod(period) && yarp::os::PeriodicThread::start();
+}
+
+void BodyExecutionHost::run()
+{
+    pool->run(instances.size(), [this](auto i) { instances[i]->step(); });
+}
+
+double BodyExecutionHost::getPeriod()
+{
+    return 1.0; // [s]
+}
+
+bool BodyExecutionHost::updateModule()
+{
+    double avgPeriod, stdPeriod, avgUsed, stdUsed;
+    yarp::os::PeriodicThread::getEstimatedPeriod(avgPeriod, stdPeriod);
+    yarp::os::PeriodicThread::getEstimatedUsed(avgUsed, stdUsed);
+
+    yDebugThrottle(5.0, "Host: %zu instances, period %.3f ms (std %.3f), used %.3f ms (std %.3f)",
+                   instances.size(), avgPeriod * 1e3, stdPeriod * 1e3, avgUsed * 1e3, stdUsed * 1e3);
+
+    return true;
+}
+
+bool BodyExecutionHost::interruptModule()
+{
+    bool ok = true;
+
+    for (auto & instance : instances)
+    {
+        ok &= instance->interruptModule();
+    }
+
+    return ok;
+}
+
+bool BodyExecutionHost::close()
+{
+    if (yarp::os::PeriodicThread::isRunning())
+    {
+        yarp::os::PeriodicThread::stop();
+    }
+
+    instances.clear(); // closed on destruction
+    pool.reset();
+    return true;
+}
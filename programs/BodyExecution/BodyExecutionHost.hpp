@@ -0,0 +1,52 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __BODY_EXECUTION_HOST_HPP__
+#define __BODY_EXECUTION_HOST_HPP__
+
+#include <memory>
+#include <vector>
+
+#include <yarp/os/PeriodicThread.h>
+#include <yarp/os/RFModule.h>
+
+#include "BodyExecution.hpp"
+#include "WorkerPool.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Hosts several BodyExecution instances (one per robot) in a single process.
+ *
+ * Instances are stepped periodically by a shared pool of worker threads instead of running their
+ * own module loops and control threads. Each one keeps its own RPC and state ports.
+ */
+class BodyExecutionHost : public yarp::os::RFModule,
+                          public yarp::os::PeriodicThread
+{
+public:
+    BodyExecutionHost()
+        : yarp::os::PeriodicThread(1.0, yarp::os::PeriodicThreadClock::Absolute)
+    {}
+
+    ~BodyExecutionHost()
+    { close(); }
+
+    bool configure(yarp::os::ResourceFinder & rf) override;
+    bool close() override;
+    bool interruptModule() override;
+    double getPeriod() override;
+    bool updateModule() override;
+
+protected:
+    void run() override;
+
+private:
+    std::vector<std::unique_ptr<BodyExecution>> instances;
+    std::unique_ptr<WorkerPool> pool;
+};
+
+} // namespace roboticslab
+
+#endif // __BODY_EXECUTION_HOST_HPP__
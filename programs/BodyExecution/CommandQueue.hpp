@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __COMMAND_QUEUE_HPP__
+#define __COMMAND_QUEUE_HPP__
+
+#include <cstddef>
+
+#include <array>
+#include <atomic>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Bounded lock-free queue for many producers and a single consumer.
+ *
+ * Based on the bounded queue by D. Vyukov: each cell carries a sequence number that tells whether
+ * it is ready to be written or read, hence neither side ever blocks the other one.
+ */
+template <typename T, std::size_t Capacity>
+class CommandQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    CommandQueue()
+    {
+        for (auto i = 0; i < Capacity; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    CommandQueue(const CommandQueue &) = delete;
+    CommandQueue & operator=(const CommandQueue &) = delete;
+
+    //! Returns false if full (any thread).
+    bool push(const T & value)
+    {
+        auto pos = tail.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            auto & cell = cells[pos & (Capacity - 1)];
+            auto diff = static_cast<std::ptrdiff_t>(cell.sequence.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! Returns false if empty (consumer thread only).
+    bool pop(T & value)
+    {
+        auto & cell = cells[head & (Capacity - 1)];
+
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+        {
+            return false;
+        }
+
+        value = cell.value;
+        cell.sequence.store(head + Capacity, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::array<Cell, Capacity> cells;
+    alignas(64) std::atomic<std::size_t> tail {0}; // producers
+    alignas(64) std::size_t head {0}; // consumer
+};
+
+} // namespace roboticslab
+
+#endif // __COMMAND_QUEUE_HPP__
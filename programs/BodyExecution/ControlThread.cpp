@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "ControlThread.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cmath> // std::abs
+#include <cstring> // std::strerror
+
+#include <algorithm> // std::max
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/SystemClock.h>
+
+using namespace roboticslab;
+
+ControlThread::ControlThread(double period, int _priority, int _cpu, const std::function<void()> & _step)
+    : yarp::os::PeriodicThread(period, yarp::os::PeriodicThreadClock::Absolute),
+      priority(_priority),
+      cpu(_cpu),
+      step(_step)
+{}
+
+bool ControlThread::threadInit()
+{
+    if (priority >= 0)
+    {
+        sched_param param {};
+        param.sched_priority = priority;
+
+        if (int ret = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param); ret != 0)
+        {
+            yError() << "Unable to set SCHED_FIFO priority" << priority << "to control thread:" << std::strerror(ret);
+            return false;
+        }
+
+        yInfo() << "Control thread running with SCHED_FIFO priority" << priority;
+    }
+
+    if (cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+
+        if (int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset); ret != 0)
+        {
+            yError() << "Unable to pin control thread to CPU" << cpu << "-" << std::strerror(ret);
+            return false;
+        }
+
+        yInfo() << "Control thread pinned to CPU" << cpu;
+    }
+
+    return true;
+}
+
+void ControlThread::run()
+{
+    auto start = yarp::os::SystemClock::nowSystem();
+
+    step();
+
+    auto used = yarp::os::SystemClock::nowSystem() - start;
+
+    std::lock_guard lock(statsMutex);
+    stats.cycles++;
+
+    if (used > getPeriod())
+    {
+        stats.overruns++;
+    }
+
+    stats.meanUsed += (used - stats.meanUsed) / stats.cycles;
+    stats.maxUsed = std::max(stats.maxUsed, used);
+
+    if (lastStart != 0.0)
+    {
+        // the first cycle has no predecessor, hence one less sample
+        auto jitter = std::abs(start - lastStart - getPeriod());
+        stats.meanJitter += (jitter - stats.meanJitter) / (stats.cycles - 1);
+        stats.maxJitter = std::max(stats.maxJitter, jitter);
+    }
+
+    lastStart = start;
+}
+
+ControlThread::Statistics ControlThread::getStatistics()
+{
+    std::lock_guard lock(statsMutex);
+    return stats;
+}
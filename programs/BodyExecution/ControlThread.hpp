@@ -0,0 +1,55 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __CONTROL_THREAD_HPP__
+#define __CONTROL_THREAD_HPP__
+
+#include <functional>
+#include <mutex>
+
+#include <yarp/os/PeriodicThread.h>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Periodic thread that runs a control step with optional real-time scheduling.
+ *
+ * Keeps track of the actual period (jitter), the time spent on each step and the number of
+ * overruns, i.e. steps that took longer than the nominal period.
+ */
+class ControlThread : public yarp::os::PeriodicThread
+{
+public:
+    struct Statistics
+    {
+        unsigned int cycles { 0 };
+        unsigned int overruns { 0 };
+        double meanJitter { 0.0 }; // [s]
+        double maxJitter { 0.0 }; // [s], absolute value
+        double meanUsed { 0.0 }; // [s]
+        double maxUsed { 0.0 }; // [s]
+    };
+
+    //! A negative priority keeps the default scheduling policy, a negative CPU disables pinning.
+    ControlThread(double period, int priority, int cpu, const std::function<void()> & step);
+
+    Statistics getStatistics();
+
+protected:
+    bool threadInit() override;
+    void run() override;
+
+private:
+    const int priority;
+    const int cpu;
+    const std::function<void()> step;
+
+    std::mutex statsMutex;
+    Statistics stats;
+    double lastStart { 0.0 };
+};
+
+} // namespace roboticslab
+
+#endif // __CONTROL_THREAD_HPP__
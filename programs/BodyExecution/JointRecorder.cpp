@@ -0,0 +1,295 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "JointRecorder.hpp"
+
+#include <fcntl.h> // ::open
+#include <sys/mman.h> // ::mmap, ::munmap
+#include <sys/stat.h> // ::fstat
+#include <unistd.h> // ::close
+
+#include <cmath> // std::llround
+#include <cstring> // std::memcmp, std::memcpy
+
+#include <algorithm> // std::max
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/SystemClock.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    constexpr char MAGIC[8] = {'T', 'E', 'O', 'J', 'L', 'O', 'G', '\0'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr double QUANTUM = 1e-3; // [deg]
+    constexpr double TICK = 1e-6; // [s]
+
+    struct FileHeader
+    {
+        char magic[sizeof(MAGIC)];
+        std::uint32_t version;
+        std::uint32_t numAxes;
+        double quantum; // [deg]
+        double tick; // [s]
+    };
+
+    // LEB128, signed values are zigzag-encoded first
+    void putVarint(std::ofstream & out, std::uint64_t value)
+    {
+        char buffer[10];
+        int n = 0;
+
+        while (value >= 0x80)
+        {
+            buffer[n++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+
+        buffer[n++] = static_cast<char>(value);
+        out.write(buffer, n);
+    }
+
+    bool getVarint(const unsigned char *& p, const unsigned char * end, std::uint64_t & value)
+    {
+        value = 0;
+
+        for (auto shift = 0; shift < 64 && p != end; shift += 7)
+        {
+            auto byte = *p++;
+            value |= std::uint64_t(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false; // truncated or malformed
+    }
+
+    std::uint64_t zigzag(std::int64_t value)
+    {
+        return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+    }
+
+    std::int64_t unzigzag(std::uint64_t value)
+    {
+        return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+    }
+}
+
+JointRecorder::JointRecorder(double period, JointStateCache & _stateCache, std::size_t _numAxes)
+    : yarp::os::PeriodicThread(period, yarp::os::PeriodicThreadClock::Absolute),
+      stateCache(_stateCache),
+      numAxes(_numAxes)
+{}
+
+JointRecorder::~JointRecorder()
+{
+    close();
+}
+
+bool JointRecorder::open(const std::string & path)
+{
+    if (numAxes == 0 || numAxes > MAX_AXES)
+    {
+        yError() << "Unable to record" << numAxes << "axes, max:" << MAX_AXES;
+        return false;
+    }
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!out)
+    {
+        yError() << "Unable to open" << path << "for writing";
+        return false;
+    }
+
+    FileHeader header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numAxes = numAxes;
+    header.quantum = QUANTUM;
+    header.tick = TICK;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    writing = true;
+    writer = std::thread(&JointRecorder::write, this);
+
+    if (!start())
+    {
+        yError() << "Failed to start joint recorder";
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void JointRecorder::close()
+{
+    if (isRunning())
+    {
+        stop();
+    }
+
+    writing = false;
+
+    if (writer.joinable())
+    {
+        writer.join(); // drains the queue first
+    }
+
+    if (out.is_open())
+    {
+        out.close();
+    }
+}
+
+void JointRecorder::run()
+{
+    Sample sample;
+    sample.timestamp = yarp::os::SystemClock::nowSystem();
+
+    if (!stateCache.getEncoders(sample.q.data()))
+    {
+        return; // a gap in the log, timestamps tell
+    }
+
+    if (!samples.push(sample))
+    {
+        dropped++;
+    }
+}
+
+void JointRecorder::write()
+{
+    std::array<std::int64_t, MAX_AXES> previous {};
+    double previousTimestamp = 0.0;
+    bool isFirst = true;
+    Sample sample;
+
+    while (true)
+    {
+        bool isStopping = !writing; // read before draining, so that no sample is left behind
+
+        while (samples.pop(sample))
+        {
+            auto ticks = isFirst ? 0 : std::max(0LL, std::llround((sample.timestamp - previousTimestamp) / TICK));
+            putVarint(out, ticks);
+
+            for (auto i = 0; i < numAxes; i++)
+            {
+                auto quantized = std::llround(sample.q[i] / QUANTUM);
+                putVarint(out, zigzag(quantized - previous[i]));
+                previous[i] = quantized;
+            }
+
+            previousTimestamp = sample.timestamp;
+            isFirst = false;
+            recorded++;
+        }
+
+        if (isStopping)
+        {
+            break;
+        }
+
+        yarp::os::SystemClock::delaySystem(0.01);
+    }
+
+    if (!out.flush())
+    {
+        yWarning() << "Failed to write joint log";
+    }
+}
+
+bool JointRecorder::load(const std::string & path, std::size_t numAxes, std::vector<double> & waypoints, std::vector<double> & durations)
+{
+    waypoints.clear();
+    durations.clear();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd == -1)
+    {
+        yError() << "Unable to open joint log" << path;
+        return false;
+    }
+
+    struct stat info;
+
+    if (::fstat(fd, &info) == -1 || info.st_size < sizeof(FileHeader))
+    {
+        yError() << "Illegal size of joint log" << path;
+        ::close(fd);
+        return false;
+    }
+
+    void * mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping outlives the descriptor
+
+    if (mapping == MAP_FAILED)
+    {
+        yError() << "Unable to map joint log" << path;
+        return false;
+    }
+
+    const auto * base = static_cast<const unsigned char *>(mapping);
+    const auto * end = base + info.st_size;
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.numAxes != numAxes || header.quantum <= 0.0 || header.tick <= 0.0)
+    {
+        yError() << "Unrecognized format, version or number of axes of joint log" << path;
+        ::munmap(mapping, info.st_size);
+        return false;
+    }
+
+    std::vector<std::int64_t> quantized(numAxes, 0);
+    const auto * p = base + sizeof(FileHeader);
+    bool ok = true;
+
+    while (ok && p != end)
+    {
+        std::uint64_t value;
+
+        if (!(ok = getVarint(p, end, value)))
+        {
+            break;
+        }
+
+        if (!waypoints.empty())
+        {
+            durations.push_back(value * header.tick);
+        }
+
+        for (auto i = 0; i < numAxes && ok; i++)
+        {
+            if ((ok = getVarint(p, end, value)))
+            {
+                quantized[i] += unzigzag(value);
+                waypoints.push_back(quantized[i] * header.quantum);
+            }
+        }
+    }
+
+    ::munmap(mapping, info.st_size);
+
+    if (!ok)
+    {
+        yError() << "Truncated or corrupted joint log" << path;
+        return false;
+    }
+
+    if (waypoints.empty())
+    {
+        yError() << "Joint log" << path << "is empty";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __JOINT_RECORDER_HPP__
+#define __JOINT_RECORDER_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <yarp/os/PeriodicThread.h>
+
+#include "CommandQueue.hpp"
+#include "JointStateCache.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Samples joint positions at a fixed rate and logs them to a compact binary file.
+ *
+ * Sampling happens on its own periodic thread, which hands samples over to a writer thread through
+ * a lock-free queue (samples are dropped if the writer falls behind). Positions are quantized and
+ * delta-encoded as variable-length integers, along with the time elapsed since the previous sample.
+ * A log can be read back with load(), which maps the file into memory.
+ */
+class JointRecorder : public yarp::os::PeriodicThread
+{
+public:
+    static constexpr std::size_t MAX_AXES = 32;
+
+    JointRecorder(double period, JointStateCache & stateCache, std::size_t numAxes);
+    ~JointRecorder() override;
+
+    //! Create the log and start sampling.
+    bool open(const std::string & path);
+
+    //! Stop sampling and write pending samples.
+    void close();
+
+    unsigned int getRecordedCount() const
+    { return recorded; }
+
+    unsigned int getDroppedCount() const
+    { return dropped; }
+
+    //! Decode a log, waypoints are stored in row-major order and durations between consecutive samples.
+    static bool load(const std::string & path, std::size_t numAxes, std::vector<double> & waypoints, std::vector<double> & durations);
+
+protected:
+    void run() override;
+
+private:
+    struct Sample
+    {
+        double timestamp; // [s]
+        std::array<double, MAX_AXES> q; // [deg]
+    };
+
+    void write();
+
+    JointStateCache & stateCache;
+    const std::size_t numAxes;
+
+    CommandQueue<Sample, 256> samples;
+    std::thread writer;
+    std::atomic<bool> writing { false };
+    std::ofstream out;
+
+    std::atomic<unsigned int> recorded { 0 };
+    std::atomic<unsigned int> dropped { 0 };
+};
+
+} // namespace roboticslab
+
+#endif // __JOINT_RECORDER_HPP__
@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "JointStateCache.hpp"
+
+#include <algorithm> // std::all_of, std::any_of, std::copy
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/SystemClock.h>
+
+using namespace roboticslab;
+
+JointStateCache::Reader::Reader(JointStateCache & _owner, std::size_t _offset, std::size_t _size)
+    : owner(_owner),
+      offset(_offset),
+      size(_size)
+{}
+
+void JointStateCache::Reader::onRead(yarp::sig::Vector & state)
+{
+    if (state.size() < size)
+    {
+        yWarningThrottle(1.0) << "Expected at least" << size << "joints on" << port.getName() << "got" << state.size();
+        return;
+    }
+
+    std::lock_guard lock(owner.mutex);
+    std::copy(state.data(), state.data() + size, owner.positions.begin() + offset); // extra axes follow, if any
+    received = yarp::os::SystemClock::nowSystem();
+}
+
+bool JointStateCache::configure(yarp::dev::IEncoders * _iEncoders, std::size_t numAxes, double _maxAge)
+{
+    iEncoders = _iEncoders;
+    maxAge = _maxAge;
+    positions.resize(numAxes);
+    return iEncoders && numAxes != 0;
+}
+
+bool JointStateCache::subscribe(const std::string & remote, const std::string & local, std::size_t offset, std::size_t size)
+{
+    if (offset + size > positions.size())
+    {
+        yError() << "Joints of" << remote << "out of range";
+        return false;
+    }
+
+    if (std::any_of(readers.cbegin(), readers.cend(), [offset, size](const auto & reader) { return reader->overlaps(offset, size); }))
+    {
+        yError() << "Joints of" << remote << "already subscribed";
+        return false;
+    }
+
+    auto & reader = readers.emplace_back(std::make_unique<Reader>(*this, offset, size));
+
+    if (!reader->port.open(local))
+    {
+        yError() << "Unable to open state port" << local;
+        readers.pop_back();
+        return false;
+    }
+
+    reader->port.useCallback(*reader);
+
+    if (!yarp::os::Network::connect(remote, local))
+    {
+        yError() << "Unable to connect" << remote << "to" << local;
+        reader->port.close();
+        readers.pop_back();
+        return false;
+    }
+
+    subscribedAxes += size;
+    return true;
+}
+
+void JointStateCache::close()
+{
+    for (auto & reader : readers)
+    {
+        reader->port.disableCallback();
+        reader->port.close();
+    }
+
+    readers.clear();
+    subscribedAxes = 0;
+}
+
+bool JointStateCache::getEncoders(double * q)
+{
+    {
+        std::lock_guard lock(mutex);
+        auto now = yarp::os::SystemClock::nowSystem();
+
+        // every joint must be streamed, boards left unsubscribed are only known to the remapper
+        if (subscribedAxes == positions.size() && std::all_of(readers.cbegin(), readers.cend(), [this, now](const auto & reader) { return now - reader->received <= maxAge; }))
+        {
+            std::copy(positions.cbegin(), positions.cend(), q);
+            served++;
+            return true;
+        }
+    }
+
+    // some board has not streamed lately (or at all, or was never subscribed), ask the remapper instead
+    if (!iEncoders->getEncoders(q))
+    {
+        return false;
+    }
+
+    refreshed++;
+    return true;
+}
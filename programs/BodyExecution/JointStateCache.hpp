@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __JOINT_STATE_CACHE_HPP__
+#define __JOINT_STATE_CACHE_HPP__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/TypedReaderCallback.h>
+
+#include <yarp/sig/Vector.h>
+
+#include <yarp/dev/IEncoders.h>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Local copy of the joint positions streamed by the remote control boards.
+ *
+ * Each board pushes its encoder readings through its state port, which is subscribed to and
+ * copied into the cache on arrival. Reads are then served from memory as long as every board has
+ * reported within the configured bound, otherwise (or if any board could not be subscribed to) the
+ * remapper is queried instead.
+ */
+class JointStateCache
+{
+public:
+    ~JointStateCache()
+    { close(); }
+
+    bool configure(yarp::dev::IEncoders * iEncoders, std::size_t numAxes, double maxAge);
+
+    //! Listen to the state stream of a board whose joints start at the given offset.
+    bool subscribe(const std::string & remote, const std::string & local, std::size_t offset, std::size_t size);
+
+    void close();
+
+    //! Copy the current joint positions into q.
+    bool getEncoders(double * q);
+
+    unsigned int getServedCount() const
+    { return served; }
+
+    unsigned int getRefreshedCount() const
+    { return refreshed; }
+
+private:
+    class Reader : public yarp::os::TypedReaderCallback<yarp::sig::Vector>
+    {
+    public:
+        Reader(JointStateCache & owner, std::size_t offset, std::size_t size);
+        void onRead(yarp::sig::Vector & state) override;
+
+        bool overlaps(std::size_t _offset, std::size_t _size) const
+        { return _offset < offset + size && offset < _offset + _size; }
+
+        yarp::os::BufferedPort<yarp::sig::Vector> port;
+        double received { 0.0 }; // guarded by owner.mutex
+
+    private:
+        JointStateCache & owner;
+        const std::size_t offset;
+        const std::size_t size;
+    };
+
+    double maxAge { 0.0 };
+    yarp::dev::IEncoders * iEncoders { nullptr };
+
+    std::mutex mutex;
+    std::vector<double> positions;
+    std::vector<std::unique_ptr<Reader>> readers;
+    std::size_t subscribedAxes { 0 }; // readers never overlap
+
+    std::atomic<unsigned int> served { 0 };
+    std::atomic<unsigned int> refreshed { 0 };
+};
+
+} // namespace roboticslab
+
+#endif // __JOINT_STATE_CACHE_HPP__
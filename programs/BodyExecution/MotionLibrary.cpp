@@ -0,0 +1,336 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "MotionLibrary.hpp"
+
+#include <fcntl.h> // ::open
+#include <sys/mman.h> // ::mmap, ::munmap
+#include <sys/stat.h> // ::fstat
+#include <unistd.h> // ::close
+
+#include <cstring> // std::memcmp, std::memcpy, std::strncpy, ::strnlen
+
+#include <fstream>
+#include <utility> // std::pair
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Value.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    constexpr char MAGIC[8] = {'T', 'E', 'O', 'M', 'L', 'I', 'B', '\0'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::size_t NAME_LENGTH = 32; // includes null terminator
+
+    // all sections are 8-byte aligned so that waypoints can be read in place
+    struct FileHeader
+    {
+        char magic[sizeof(MAGIC)];
+        std::uint32_t version;
+        std::uint32_t numAxes;
+        std::uint32_t numActions;
+        std::uint32_t numWaypoints;
+    };
+
+    struct FileAction
+    {
+        char name[NAME_LENGTH];
+        std::uint32_t offset; // in waypoints
+        std::uint32_t size; // in waypoints
+    };
+
+    static_assert(sizeof(FileHeader) % alignof(double) == 0);
+    static_assert(sizeof(FileAction) % alignof(double) == 0);
+
+    std::string_view toStringView(const char (& name)[NAME_LENGTH])
+    {
+        return {name, ::strnlen(name, NAME_LENGTH)};
+    }
+
+    void flatten(const yarp::os::Value & value, std::vector<double> & out)
+    {
+        if (value.isList())
+        {
+            const auto * list = value.asList();
+
+            for (auto i = 0; i < list->size(); i++)
+            {
+                flatten(list->get(i), out);
+            }
+        }
+        else
+        {
+            out.push_back(value.asFloat64());
+        }
+    }
+}
+
+bool MotionLibrary::fromConfigFile(const std::string & path)
+{
+    clear();
+
+    yarp::os::Property config;
+
+    if (!config.fromConfigFile(path))
+    {
+        yError() << "Unable to load motion library from" << path;
+        return false;
+    }
+
+    const auto * axesList = config.find("axes").asList();
+    const auto * actionsList = config.find("actions").asList();
+
+    if (!axesList || axesList->size() == 0)
+    {
+        yError() << "Motion library" << path << "does not declare any axes";
+        return false;
+    }
+
+    if (!actionsList)
+    {
+        yError() << "Motion library" << path << "does not declare any actions";
+        return false;
+    }
+
+    for (auto i = 0; i < axesList->size(); i++)
+    {
+        axes.push_back(axesList->get(i).asString());
+    }
+
+    ownedNames.reserve(actionsList->size()); // keeps string_views valid
+
+    std::vector<std::pair<std::size_t, std::size_t>> ranges; // offset and size, in waypoints
+
+    for (auto i = 0; i < actionsList->size(); i++)
+    {
+        const auto & name = ownedNames.emplace_back(actionsList->get(i).asString());
+
+        if (name.empty() || name.size() >= NAME_LENGTH)
+        {
+            yError() << "Illegal action name" << name << "(max length:" << NAME_LENGTH - 1 << "characters)";
+            return false;
+        }
+
+        const auto & waypoints = config.findGroup(name).findGroup("waypoints");
+
+        if (waypoints.size() < 2)
+        {
+            yError() << "Action" << name << "does not have any waypoints";
+            return false;
+        }
+
+        ranges.emplace_back(ownedWaypoints.size() / axes.size(), waypoints.size() - 1);
+
+        for (auto j = 1; j < waypoints.size(); j++)
+        {
+            auto previousSize = ownedWaypoints.size();
+            flatten(waypoints.get(j), ownedWaypoints);
+
+            if (ownedWaypoints.size() - previousSize != axes.size())
+            {
+                yError("Waypoint %d of action %s has %zu values, expected %zu", j, name.c_str(),
+                       ownedWaypoints.size() - previousSize, axes.size());
+                return false;
+            }
+        }
+    }
+
+    // waypoint storage is stable from now on
+    for (auto i = 0; i < ownedNames.size(); i++)
+    {
+        const auto & [offset, size] = ranges[i];
+        actions.push_back({ownedNames[i], ownedWaypoints.data() + offset * axes.size(), size});
+    }
+
+    return buildIndex();
+}
+
+bool MotionLibrary::fromBinaryFile(const std::string & path)
+{
+    clear();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd == -1)
+    {
+        yError() << "Unable to open compiled motion library" << path;
+        return false;
+    }
+
+    struct stat info;
+
+    if (::fstat(fd, &info) == -1 || info.st_size < sizeof(FileHeader))
+    {
+        yError() << "Illegal size of compiled motion library" << path;
+        ::close(fd);
+        return false;
+    }
+
+    mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping outlives the descriptor
+
+    if (mapping == MAP_FAILED)
+    {
+        yError() << "Unable to map compiled motion library" << path;
+        mapping = nullptr;
+        return false;
+    }
+
+    mappingSize = info.st_size;
+
+    const auto * base = static_cast<const char *>(mapping);
+    const auto * header = reinterpret_cast<const FileHeader *>(base);
+
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+    {
+        yError() << "Unrecognized format or version of compiled motion library" << path;
+        return false;
+    }
+
+    auto expectedSize = sizeof(FileHeader)
+                      + std::size_t(header->numAxes) * NAME_LENGTH
+                      + std::size_t(header->numActions) * sizeof(FileAction)
+                      + std::size_t(header->numWaypoints) * header->numAxes * sizeof(double);
+
+    if (header->numAxes == 0 || expectedSize != mappingSize)
+    {
+        yError() << "Truncated or corrupted compiled motion library" << path;
+        return false;
+    }
+
+    const auto * axisNames = reinterpret_cast<const char (*)[NAME_LENGTH]>(base + sizeof(FileHeader));
+    const auto * fileActions = reinterpret_cast<const FileAction *>(axisNames + header->numAxes);
+    const auto * waypoints = reinterpret_cast<const double *>(fileActions + header->numActions);
+
+    for (auto i = 0; i < header->numAxes; i++)
+    {
+        axes.emplace_back(toStringView(axisNames[i]));
+    }
+
+    for (auto i = 0; i < header->numActions; i++)
+    {
+        const auto & fileAction = fileActions[i];
+
+        if (fileAction.size == 0 || std::uint64_t(fileAction.offset) + fileAction.size > header->numWaypoints)
+        {
+            yError() << "Illegal waypoint range in compiled motion library" << path;
+            return false;
+        }
+
+        actions.push_back({toStringView(fileAction.name), waypoints + std::size_t(fileAction.offset) * header->numAxes, fileAction.size});
+    }
+
+    return buildIndex();
+}
+
+bool MotionLibrary::toBinaryFile(const std::string & path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    if (!out)
+    {
+        yError() << "Unable to open" << path << "for writing";
+        return false;
+    }
+
+    FileHeader header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numAxes = axes.size();
+    header.numActions = actions.size();
+
+    for (const auto & action : actions)
+    {
+        header.numWaypoints += action.size;
+    }
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (const auto & axis : axes)
+    {
+        char name[NAME_LENGTH] {};
+        std::strncpy(name, axis.c_str(), NAME_LENGTH - 1);
+        out.write(name, NAME_LENGTH);
+    }
+
+    std::uint32_t offset = 0;
+
+    for (const auto & action : actions)
+    {
+        FileAction fileAction {};
+        action.name.copy(fileAction.name, NAME_LENGTH - 1);
+        fileAction.offset = offset;
+        fileAction.size = action.size;
+        out.write(reinterpret_cast<const char *>(&fileAction), sizeof(fileAction));
+        offset += action.size;
+    }
+
+    for (const auto & action : actions)
+    {
+        out.write(reinterpret_cast<const char *>(action.waypoints), action.size * axes.size() * sizeof(double));
+    }
+
+    if (!out)
+    {
+        yError() << "Failed to write compiled motion library to" << path;
+        return false;
+    }
+
+    return true;
+}
+
+bool MotionLibrary::hasAxes(const std::vector<std::string> & expected) const
+{
+    if (axes != expected)
+    {
+        yError() << "Motion library axes do not match robot axes, expected:" << expected << "got:" << axes;
+        return false;
+    }
+
+    return true;
+}
+
+const MotionLibrary::Action * MotionLibrary::find(std::string_view name) const
+{
+    if (auto it = index.find(name); it != index.cend())
+    {
+        return &actions[it->second];
+    }
+
+    return nullptr;
+}
+
+void MotionLibrary::clear()
+{
+    axes.clear();
+    actions.clear();
+    index.clear();
+    ownedNames.clear();
+    ownedWaypoints.clear();
+
+    if (mapping)
+    {
+        ::munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+bool MotionLibrary::buildIndex()
+{
+    index.reserve(actions.size());
+
+    for (auto i = 0; i < actions.size(); i++)
+    {
+        if (!index.emplace(actions[i].name, i).second)
+        {
+            yError() << "Duplicate action name in motion library:" << std::string(actions[i].name);
+            return false;
+        }
+    }
+
+    return true;
+}
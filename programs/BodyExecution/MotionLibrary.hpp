@@ -0,0 +1,84 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __MOTION_LIBRARY_HPP__
+#define __MOTION_LIBRARY_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Immutable collection of named choreographies (sequences of joint-space waypoints).
+ *
+ * Actions are loaded either from a text source (YARP .ini format) or from its compiled binary
+ * counterpart, which is memory-mapped as is. Waypoints are stored contiguously in row-major order,
+ * i.e. one row per waypoint and one column per axis, in the order declared by the library.
+ */
+class MotionLibrary
+{
+public:
+    struct Action
+    {
+        std::string_view name;
+        const double * waypoints; // size * numAxes
+        std::size_t size;
+
+        const double * waypoint(std::size_t i, std::size_t numAxes) const
+        { return waypoints + i * numAxes; }
+    };
+
+    MotionLibrary() = default;
+    MotionLibrary(const MotionLibrary &) = delete;
+    MotionLibrary & operator=(const MotionLibrary &) = delete;
+
+    ~MotionLibrary()
+    { clear(); }
+
+    bool fromConfigFile(const std::string & path);
+    bool fromBinaryFile(const std::string & path);
+    bool toBinaryFile(const std::string & path) const;
+
+    bool hasAxes(const std::vector<std::string> & expected) const;
+
+    const Action * find(std::string_view name) const;
+
+    std::size_t getNumAxes() const
+    { return axes.size(); }
+
+    std::size_t getNumActions() const
+    { return actions.size(); }
+
+    const std::vector<std::string> & getAxes() const
+    { return axes; }
+
+    const std::vector<Action> & getActions() const
+    { return actions; }
+
+private:
+    void clear();
+    bool buildIndex();
+
+    std::vector<std::string> axes;
+    std::vector<Action> actions;
+    std::unordered_map<std::string_view, std::size_t> index;
+
+    // storage backing the text source
+    std::vector<std::string> ownedNames;
+    std::vector<double> ownedWaypoints;
+
+    // storage backing the binary source
+    void * mapping { nullptr };
+    std::size_t mappingSize { 0 };
+};
+
+} // namespace roboticslab
+
+#endif // __MOTION_LIBRARY_HPP__
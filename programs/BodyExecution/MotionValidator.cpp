@@ -0,0 +1,433 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "MotionValidator.hpp"
+
+#include <cmath> // std::abs, std::ceil, std::cos, std::sin, std::sqrt
+#include <cstdio> // std::snprintf
+
+#include <algorithm> // std::max, std::min
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Value.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    constexpr double MAX_SAMPLE_STEP = 2.0; // [deg], max joint displacement between samples
+    constexpr double LIMIT_TOLERANCE = 1e-6; // [deg]
+    constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+    // 64-bit FNV-1a
+    template <typename T>
+    void hash(std::uint64_t & h, const T * data, std::size_t n)
+    {
+        const auto * bytes = reinterpret_cast<const unsigned char *>(data);
+
+        for (auto i = 0; i < n * sizeof(T); i++)
+        {
+            h = (h ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    bool readVector(const yarp::os::Value & value, std::array<double, 3> & out)
+    {
+        const auto * list = value.asList();
+
+        if (!list || list->size() != out.size())
+        {
+            return false;
+        }
+
+        for (auto i = 0; i < out.size(); i++)
+        {
+            out[i] = list->get(i).asFloat64();
+        }
+
+        return true;
+    }
+
+    double clamp01(double x)
+    {
+        return std::min(std::max(x, 0.0), 1.0); // branchless, unlike std::clamp
+    }
+}
+
+void MotionValidator::setLimits(const std::vector<double> & _qMin, const std::vector<double> & _qMax)
+{
+    qMin = _qMin;
+    qMax = _qMax;
+}
+
+bool MotionValidator::loadKinematics(const std::string & path, std::size_t numAxes)
+{
+    chains.clear();
+
+    yarp::os::Property config;
+
+    if (!config.fromConfigFile(path))
+    {
+        yError() << "Unable to load kinematic model from" << path;
+        return false;
+    }
+
+    const auto * names = config.find("chains").asList();
+
+    if (!names)
+    {
+        yError() << "Kinematic model" << path << "does not declare any chains";
+        return false;
+    }
+
+    margin = config.check("margin", yarp::os::Value(0.0)).asFloat64();
+
+    for (auto c = 0; c < names->size(); c++)
+    {
+        auto & chain = chains.emplace_back();
+        chain.name = names->get(c).asString();
+
+        const auto & group = config.findGroup(chain.name);
+        const auto * axes = group.find("axes").asList();
+        const auto * links = group.find("links").asList();
+        const auto * radii = group.find("radii").asList();
+
+        chain.offset = group.check("offset", yarp::os::Value(0)).asInt32();
+
+        if (!axes || !links || !radii || links->size() != axes->size() || radii->size() != axes->size()
+            || !readVector(group.find("base"), chain.base) || chain.offset + axes->size() > numAxes)
+        {
+            yError() << "Illegal chain" << chain.name << "in kinematic model" << path;
+            chains.clear();
+            return false;
+        }
+
+        for (auto j = 0; j < axes->size(); j++)
+        {
+            auto & link = chain.links.emplace_back();
+            auto axis = axes->get(j).asString();
+
+            link.sign = !axis.empty() && axis[0] == '-' ? -1.0 : 1.0;
+            axis = axis.substr(link.sign < 0.0 ? 1 : 0);
+            link.axis = axis == "x" ? 0 : axis == "y" ? 1 : axis == "z" ? 2 : -1;
+            link.radius = radii->get(j).asFloat64();
+
+            bool ok = link.axis != -1 && readVector(links->get(j), link.translation) && link.radius >= 0.0;
+
+            // a capsule needs a nonzero length (see checkSegment)
+            if (ok && link.radius > 0.0)
+            {
+                const auto & t = link.translation;
+                ok = t[0] * t[0] + t[1] * t[1] + t[2] * t[2] > 0.0;
+            }
+
+            if (!ok)
+            {
+                yError("Illegal joint %d of chain %s in kinematic model %s", j, chain.name.c_str(), path.c_str());
+                chains.clear();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MotionValidator::check(const MotionLibrary::Action & action, const std::vector<std::string> & axes, std::string & reason,
+                            const TrajectoryPlanner::Trajectory * trajectory) const
+{
+    const auto numAxes = axes.size();
+    char buffer[256];
+
+    for (auto k = 0; k < action.size; k++)
+    {
+        const auto * q = action.waypoint(k, numAxes);
+
+        for (auto i = 0; i < numAxes && i < qMin.size() && i < qMax.size(); i++)
+        {
+            if (qMin[i] < qMax[i] && (q[i] < qMin[i] - LIMIT_TOLERANCE || q[i] > qMax[i] + LIMIT_TOLERANCE))
+            {
+                std::snprintf(buffer, sizeof(buffer), "waypoint %d: %s at %.2f deg, out of [%.2f, %.2f]",
+                              k, axes[i].c_str(), q[i], qMin[i], qMax[i]);
+                reason = buffer;
+                return false;
+            }
+        }
+    }
+
+    if (action.size == 1)
+    {
+        return chains.empty() || checkSegment(action.waypoint(0, numAxes), action.waypoint(0, numAxes), nullptr, nullptr, 0.0, numAxes, axes, reason);
+    }
+
+    for (auto k = 1; k < action.size; k++)
+    {
+        const auto * segment = trajectory ? &trajectory->segments[k - 1] : nullptr;
+        const bool isBlended = segment && segment->isBlended;
+
+        if (chains.empty() && !isBlended)
+        {
+            continue; // waypoints already checked
+        }
+
+        if (!checkSegment(action.waypoint(k - 1, numAxes), action.waypoint(k, numAxes),
+                          isBlended ? trajectory->velocity(k - 1, numAxes) : nullptr,
+                          isBlended ? trajectory->velocity(k, numAxes) : nullptr,
+                          isBlended ? segment->duration : 0.0, numAxes, axes, reason))
+        {
+            std::snprintf(buffer, sizeof(buffer), "segment %d-%d: ", k - 1, k);
+            reason = buffer + reason;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MotionValidator::checkSegment(const double * q0, const double * q1, const double * v0, const double * v1, double duration,
+                                   std::size_t numAxes, const std::vector<std::string> & axes, std::string & reason) const
+{
+    const bool isBlended = v0 && v1;
+    double maxDelta = 0.0;
+
+    for (auto i = 0; i < numAxes; i++)
+    {
+        // the quintic travels at most this far, overshoot included
+        const double travel = isBlended ? std::abs(q1[i] - q0[i]) + (std::abs(v0[i]) + std::abs(v1[i])) * duration : std::abs(q1[i] - q0[i]);
+        maxDelta = std::max(maxDelta, travel);
+    }
+
+    const auto samples = static_cast<std::size_t>(std::ceil(maxDelta / MAX_SAMPLE_STEP)) + 1;
+
+    std::vector<Lane> q(numAxes);
+    std::vector<Points> points(chains.size());
+
+    for (auto c = 0; c < chains.size(); c++)
+    {
+        points[c].resize(chains[c].links.size() + 1);
+    }
+
+    for (std::size_t start = 0; start < samples; start += BATCH)
+    {
+        const auto n = std::min(BATCH, samples - start);
+        const double step = samples > 1 ? 1.0 / (samples - 1) : 0.0;
+
+        for (auto i = 0; i < numAxes; i++)
+        {
+            const double delta = q1[i] - q0[i];
+
+            for (auto b = 0; b < n; b++)
+            {
+                const double s = (start + b) * step;
+                q[i][b] = isBlended ? TrajectoryPlanner::evaluate(duration, q0[i], q1[i], v0[i], v1[i], s * duration) : q0[i] + s * delta;
+            }
+
+            if (!isBlended)
+            {
+                continue; // within limits if both ends are
+            }
+
+            for (auto b = 0; b < n; b++)
+            {
+                if (i < qMin.size() && i < qMax.size() && qMin[i] < qMax[i]
+                    && (q[i][b] < qMin[i] - LIMIT_TOLERANCE || q[i][b] > qMax[i] + LIMIT_TOLERANCE))
+                {
+                    char buffer[256];
+                    std::snprintf(buffer, sizeof(buffer), "%s overshoots to %.2f deg at %.0f%% of the way, out of [%.2f, %.2f]",
+                                  axes[i].c_str(), q[i][b], (start + b) * step * 100.0, qMin[i], qMax[i]);
+                    reason = buffer;
+                    return false;
+                }
+            }
+        }
+
+        if (chains.empty())
+        {
+            continue;
+        }
+
+        for (auto c = 0; c < chains.size(); c++)
+        {
+            forwardKinematics(chains[c], q, n, points[c]);
+        }
+
+        // capsules of different chains, pairwise
+        for (auto ca = 0; ca < chains.size(); ca++)
+        {
+            for (auto cb = ca + 1; cb < chains.size(); cb++)
+            {
+                for (auto la = 0; la < chains[ca].links.size(); la++)
+                {
+                    for (auto lb = 0; lb < chains[cb].links.size(); lb++)
+                    {
+                        const double ra = chains[ca].links[la].radius;
+                        const double rb = chains[cb].links[lb].radius;
+
+                        if (ra == 0.0 || rb == 0.0)
+                        {
+                            continue;
+                        }
+
+                        const auto & p1 = points[ca][la];
+                        const auto & p2 = points[ca][la + 1];
+                        const auto & p3 = points[cb][lb];
+                        const auto & p4 = points[cb][lb + 1];
+
+                        const double threshold = (ra + rb + margin) * (ra + rb + margin);
+                        Lane distance;
+
+                        // closest points of two segments, see Ericson, Real-Time Collision Detection (2005), 5.1.9
+                        for (auto b = 0; b < n; b++)
+                        {
+                            const double d1[3] = {p2[0][b] - p1[0][b], p2[1][b] - p1[1][b], p2[2][b] - p1[2][b]};
+                            const double d2[3] = {p4[0][b] - p3[0][b], p4[1][b] - p3[1][b], p4[2][b] - p3[2][b]};
+                            const double r[3] = {p1[0][b] - p3[0][b], p1[1][b] - p3[1][b], p1[2][b] - p3[2][b]};
+
+                            const double a = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2]; // nonzero, see loadKinematics()
+                            const double e = d2[0] * d2[0] + d2[1] * d2[1] + d2[2] * d2[2];
+                            const double f = d2[0] * r[0] + d2[1] * r[1] + d2[2] * r[2];
+                            const double cc = d1[0] * r[0] + d1[1] * r[1] + d1[2] * r[2];
+                            const double bb = d1[0] * d2[0] + d1[1] * d2[1] + d1[2] * d2[2];
+                            const double denom = a * e - bb * bb;
+
+                            double s = denom > 1e-12 ? clamp01((bb * f - cc * e) / denom) : 0.0; // parallel segments: any s
+                            const double t = clamp01((bb * s + f) / e);
+                            s = clamp01((bb * t - cc) / a);
+
+                            const double dx = r[0] + d1[0] * s - d2[0] * t;
+                            const double dy = r[1] + d1[1] * s - d2[1] * t;
+                            const double dz = r[2] + d1[2] * s - d2[2] * t;
+                            distance[b] = dx * dx + dy * dy + dz * dz;
+                        }
+
+                        for (auto b = 0; b < n; b++)
+                        {
+                            if (distance[b] < threshold)
+                            {
+                                char buffer[256];
+                                std::snprintf(buffer, sizeof(buffer), "link %d of %s and link %d of %s %.3f m apart at %.0f%% of the way",
+                                              la, chains[ca].name.c_str(), lb, chains[cb].name.c_str(),
+                                              std::sqrt(distance[b]) - ra - rb, (start + b) * step * 100.0);
+                                reason = buffer;
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void MotionValidator::forwardKinematics(const Chain & chain, const std::vector<Lane> & q, std::size_t n, Points & points) const
+{
+    std::array<Lane, 9> rotation; // column-major
+
+    for (auto k = 0; k < 9; k++)
+    {
+        rotation[k].fill(k % 4 == 0 ? 1.0 : 0.0);
+    }
+
+    for (auto i = 0; i < 3; i++)
+    {
+        points[0][i].fill(chain.base[i]);
+    }
+
+    for (auto j = 0; j < chain.links.size(); j++)
+    {
+        const auto & link = chain.links[j];
+        const auto & angle = q[chain.offset + j];
+
+        // post-multiply by the joint rotation, which mixes the two columns other than the axis
+        const auto u = 3 * ((link.axis + 1) % 3);
+        const auto v = 3 * ((link.axis + 2) % 3);
+
+        Lane c;
+        Lane s;
+
+        for (auto b = 0; b < n; b++)
+        {
+            c[b] = std::cos(link.sign * angle[b] * DEG_TO_RAD);
+            s[b] = std::sin(link.sign * angle[b] * DEG_TO_RAD);
+        }
+
+        for (auto row = 0; row < 3; row++)
+        {
+            auto & cu = rotation[u + row];
+            auto & cv = rotation[v + row];
+
+            for (auto b = 0; b < n; b++)
+            {
+                const double x = cu[b];
+                const double y = cv[b];
+                cu[b] = c[b] * x + s[b] * y;
+                cv[b] = c[b] * y - s[b] * x;
+            }
+        }
+
+        const auto & t = link.translation;
+
+        for (auto row = 0; row < 3; row++)
+        {
+            const auto & previous = points[j][row];
+            auto & next = points[j + 1][row];
+
+            for (auto b = 0; b < n; b++)
+            {
+                next[b] = previous[b] + rotation[row][b] * t[0] + rotation[3 + row][b] * t[1] + rotation[6 + row][b] * t[2];
+            }
+        }
+    }
+}
+
+std::uint64_t MotionValidator::getFingerprint(const MotionLibrary & library, const TrajectoryPlanner * planner) const
+{
+    std::uint64_t h = 14695981039346656037ULL;
+
+    for (const auto & axis : library.getAxes())
+    {
+        hash(h, axis.c_str(), axis.size() + 1);
+    }
+
+    for (const auto & action : library.getActions())
+    {
+        hash(h, action.name.data(), action.name.size());
+        hash(h, &action.size, 1);
+        hash(h, action.waypoints, action.size * library.getNumAxes());
+
+        if (const auto * trajectory = planner ? planner->find(action.name) : nullptr; trajectory)
+        {
+            hash(h, trajectory->velocities.data(), trajectory->velocities.size());
+
+            for (const auto & segment : trajectory->segments)
+            {
+                hash(h, &segment.duration, 1);
+                hash(h, &segment.isBlended, 1);
+            }
+        }
+    }
+
+    hash(h, qMin.data(), qMin.size());
+    hash(h, qMax.data(), qMax.size());
+    hash(h, &margin, 1);
+
+    for (const auto & chain : chains)
+    {
+        hash(h, chain.name.data(), chain.name.size());
+        hash(h, &chain.offset, 1);
+        hash(h, chain.base.data(), chain.base.size());
+
+        for (const auto & link : chain.links)
+        {
+            hash(h, &link.axis, 1);
+            hash(h, &link.sign, 1);
+            hash(h, link.translation.data(), link.translation.size());
+            hash(h, &link.radius, 1);
+        }
+    }
+
+    return h;
+}
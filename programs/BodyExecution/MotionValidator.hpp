@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __MOTION_VALIDATOR_HPP__
+#define __MOTION_VALIDATOR_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "MotionLibrary.hpp"
+#include "TrajectoryPlanner.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Checks actions against joint limits and self-collision before they reach the robot.
+ *
+ * Segments followed from rest to rest are straight lines in joint space, hence checking their
+ * waypoints suffices for joint limits. Blended segments (see TrajectoryPlanner) cross the waypoints
+ * with some velocity and may overshoot, hence they are sampled along the executed quintic for joint
+ * limits too. For self-collision, each segment is sampled and every chain of the kinematic model is
+ * wrapped in capsules: capsules of different chains must not come closer than the margin. Samples are processed in batches laid out as structures of arrays, so that forward
+ * kinematics and capsule distances vectorize across samples. The approach to the first waypoint
+ * (which depends on the current state) and blends between actions are not covered.
+ */
+class MotionValidator
+{
+public:
+    //! Joint ranges [deg], axes with an empty range (min >= max) are not checked.
+    void setLimits(const std::vector<double> & qMin, const std::vector<double> & qMax);
+
+    //! Load the kinematic model, see kinematics.ini.
+    bool loadKinematics(const std::string & path, std::size_t numAxes);
+
+    bool hasKinematics() const
+    { return !chains.empty(); }
+
+    //! Returns false and a human-readable reason on the first violation. Segments are straight lines
+    //! unless the planned trajectory says otherwise.
+    bool check(const MotionLibrary::Action & action, const std::vector<std::string> & axes, std::string & reason,
+               const TrajectoryPlanner::Trajectory * trajectory = nullptr) const;
+
+    //! Hash of limits, kinematic model and library contents (and their trajectories, if given), meant for caching results.
+    std::uint64_t getFingerprint(const MotionLibrary & library, const TrajectoryPlanner * planner = nullptr) const;
+
+private:
+    static constexpr std::size_t BATCH = 64;
+
+    using Lane = std::array<double, BATCH>;
+    using Points = std::vector<std::array<Lane, 3>>; // per chain point, then coordinate, then sample
+
+    struct Link
+    {
+        int axis; // 0: x, 1: y, 2: z
+        double sign;
+        std::array<double, 3> translation;
+        double radius;
+    };
+
+    struct Chain
+    {
+        std::string name;
+        std::size_t offset;
+        std::array<double, 3> base;
+        std::vector<Link> links;
+    };
+
+    //! Straight line unless blended, i.e. v0 and v1 not null.
+    bool checkSegment(const double * q0, const double * q1, const double * v0, const double * v1, double duration,
+                      std::size_t numAxes, const std::vector<std::string> & axes, std::string & reason) const;
+    void forwardKinematics(const Chain & chain, const std::vector<Lane> & q, std::size_t n, Points & points) const;
+
+    std::vector<double> qMin;
+    std::vector<double> qMax;
+    std::vector<Chain> chains;
+    double margin { 0.0 };
+};
+
+} // namespace roboticslab
+
+#endif // __MOTION_VALIDATOR_HPP__
@@ -0,0 +1,113 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __REFERENCE_SHADOW_HPP__
+#define __REFERENCE_SHADOW_HPP__
+
+#include <cmath> // std::abs
+#include <cstddef>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Local copy of per-joint parameters last accepted by the device (reference speeds, control modes...).
+ *
+ * Only joints whose new value differs from the shadowed one by more than the tolerance are forwarded to
+ * the device, the whole call is skipped if none does. Joints start unknown and become unknown again if
+ * a call fails. The lock is not held while talking to the device, so concurrent callers should address
+ * disjoint joints.
+ */
+template <typename T, std::size_t N>
+class ReferenceShadow
+{
+public:
+    explicit ReferenceShadow(T _tolerance = T())
+        : tolerance(_tolerance)
+    {}
+
+    void setTolerance(T _tolerance)
+    { tolerance = _tolerance; }
+
+    //! Forget all values, next update sends every joint.
+    void invalidate()
+    {
+        std::lock_guard lock(mutex);
+        known.fill(false);
+    }
+
+    //! Send the changed subset through send(n, indices, values), indices are shifted by offset in the shadow.
+    template <typename Send>
+    bool update(int n, const int * indices, const T * values, int offset, Send && send)
+    {
+        std::array<int, N> changedIndices;
+        std::array<T, N> changedValues;
+        int m = 0;
+
+        {
+            std::lock_guard lock(mutex);
+
+            for (auto k = 0; k < n; k++)
+            {
+                const auto i = offset + indices[k];
+
+                if (!known[i] || std::abs(values[k] - shadow[i]) > tolerance)
+                {
+                    changedIndices[m] = indices[k];
+                    changedValues[m] = values[k];
+                    m++;
+                }
+            }
+        }
+
+        suppressedJoints += n - m;
+
+        if (m == 0)
+        {
+            suppressedCalls++;
+            return true;
+        }
+
+        sentCalls++;
+        bool ok = send(m, changedIndices.data(), changedValues.data());
+
+        std::lock_guard lock(mutex);
+
+        for (auto k = 0; k < m; k++)
+        {
+            const auto i = offset + changedIndices[k];
+            shadow[i] = changedValues[k];
+            known[i] = ok; // state of the device is unknown after a failure
+        }
+
+        return ok;
+    }
+
+    unsigned int getSentCalls() const
+    { return sentCalls; }
+
+    unsigned int getSuppressedCalls() const
+    { return suppressedCalls; }
+
+    unsigned int getSuppressedJoints() const
+    { return suppressedJoints; }
+
+private:
+    T tolerance;
+
+    std::mutex mutex;
+    std::array<T, N> shadow {};
+    std::array<bool, N> known {};
+
+    std::atomic<unsigned int> sentCalls { 0 };
+    std::atomic<unsigned int> suppressedCalls { 0 };
+    std::atomic<unsigned int> suppressedJoints { 0 };
+};
+
+} // namespace roboticslab
+
+#endif // __REFERENCE_SHADOW_HPP__
@@ -0,0 +1,394 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "TrajectoryPlanner.hpp"
+
+#include <cmath> // std::abs, std::cbrt, std::sqrt
+
+#include <algorithm> // std::all_of, std::clamp, std::fill, std::max, std::min
+#include <limits>
+#include <string>
+
+#include <yarp/os/LogStream.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    // s(t) during the acceleration phase, t in [0, ta]
+    double accelerate(const TrajectoryPlanner::Profile & p, double t)
+    {
+        if (t < p.tj)
+        {
+            return p.jerk * t * t * t / 6.0;
+        }
+
+        const double a = p.getPeakAcceleration();
+
+        if (t < p.ta - p.tj)
+        {
+            return a / 6.0 * (3.0 * t * t - 3.0 * p.tj * t + p.tj * p.tj);
+        }
+
+        const double v = p.getPeakSpeed();
+        const double r = p.ta - t;
+        return v * p.ta / 2.0 - v * r + p.jerk * r * r * r / 6.0;
+    }
+
+    bool isAtRest(const double * v, std::size_t numAxes)
+    {
+        return std::all_of(v, v + numAxes, [](auto value) { return value == 0.0; });
+    }
+
+    // q(s) = q0 + c1 s + c3 s^3 + c4 s^4 + c5 s^5, with s = t / duration
+    struct Quintic
+    {
+        Quintic(double duration, double q0, double q1, double v0, double v1)
+            : c1(duration * v0),
+              c3(10.0 * (q1 - q0) - 6.0 * c1 - 4.0 * duration * v1),
+              c4(-15.0 * (q1 - q0) + 8.0 * c1 + 7.0 * duration * v1),
+              c5(6.0 * (q1 - q0) - 3.0 * c1 - 3.0 * duration * v1)
+        {}
+
+        const double c1, c3, c4, c5;
+    };
+
+    // factor by which the duration should grow so that every limit holds, were the whole segment time-scaled
+    // (speed scales by 1 / k, acceleration by 1 / k^2, jerk by 1 / k^3), at most 1 if already within limits
+    double getTimeScale(const TrajectoryPlanner::Limits & limits, std::size_t numAxes, const double * q0, const double * q1,
+                        const double * v0, const double * v1, double duration)
+    {
+        constexpr int samples = 50;
+
+        const double t2 = duration * duration;
+        const double t3 = t2 * duration;
+        double k = 0.0;
+
+        for (auto i = 0; i < numAxes; i++)
+        {
+            const Quintic p(duration, q0[i], q1[i], v0[i], v1[i]);
+
+            for (auto n = 0; n <= samples; n++)
+            {
+                const double s = static_cast<double>(n) / samples;
+                const double v = (p.c1 + s * s * (3.0 * p.c3 + s * (4.0 * p.c4 + s * 5.0 * p.c5))) / duration;
+                const double a = s * (6.0 * p.c3 + s * (12.0 * p.c4 + s * 20.0 * p.c5)) / t2;
+                const double j = (6.0 * p.c3 + s * (24.0 * p.c4 + s * 60.0 * p.c5)) / t3;
+
+                k = std::max({k, std::abs(v) / limits.maxSpeed[i], std::sqrt(std::abs(a) / limits.maxAcceleration[i]),
+                              std::cbrt(std::abs(j) / limits.maxJerk[i])});
+            }
+        }
+
+        return k;
+    }
+}
+
+double TrajectoryPlanner::Profile::evaluate(double t) const
+{
+    const double duration = getDuration();
+
+    if (t <= 0.0)
+    {
+        return duration > 0.0 ? 0.0 : 1.0;
+    }
+
+    if (t >= duration)
+    {
+        return 1.0;
+    }
+
+    if (t < ta)
+    {
+        return accelerate(*this, t);
+    }
+
+    if (t < ta + tv)
+    {
+        return getPeakSpeed() * (ta / 2.0 + t - ta);
+    }
+
+    return 1.0 - accelerate(*this, duration - t); // deceleration mirrors acceleration
+}
+
+TrajectoryPlanner::Profile TrajectoryPlanner::Profile::stretch(double duration) const
+{
+    if (getDuration() == 0.0)
+    {
+        return linear(duration); // no motion, just wait
+    }
+
+    // s(t / k): time intervals scale by k, jerk by 1 / k^3
+    const double k = duration / getDuration();
+
+    Profile p;
+    p.tj = tj * k;
+    p.ta = ta * k;
+    p.tv = tv * k;
+    p.jerk = jerk / (k * k * k);
+    return p;
+}
+
+double TrajectoryPlanner::Trajectory::getDuration(bool stopAtWaypoints) const
+{
+    double duration = 0.0;
+
+    for (const auto & segment : segments)
+    {
+        duration += stopAtWaypoints ? segment.profile.getDuration() : segment.duration;
+    }
+
+    return duration;
+}
+
+TrajectoryPlanner::Trajectory TrajectoryPlanner::Trajectory::fromProfiles(std::vector<Profile> profiles, std::size_t numAxes)
+{
+    Trajectory trajectory;
+    trajectory.segments.reserve(profiles.size());
+    trajectory.velocities.assign((profiles.size() + 1) * numAxes, 0.0);
+
+    for (const auto & profile : profiles)
+    {
+        auto & segment = trajectory.segments.emplace_back();
+        segment.profile = profile;
+        segment.duration = profile.getDuration();
+    }
+
+    return trajectory;
+}
+
+bool TrajectoryPlanner::configure(const MotionLibrary & library, const Limits & _limits)
+{
+    numAxes = library.getNumAxes();
+    limits = _limits;
+
+    if (limits.maxSpeed.size() != numAxes || limits.maxAcceleration.size() != numAxes || limits.maxJerk.size() != numAxes)
+    {
+        yError() << "Expected joint limits for" << numAxes << "axes";
+        return false;
+    }
+
+    for (auto i = 0; i < numAxes; i++)
+    {
+        if (limits.maxSpeed[i] <= 0.0 || limits.maxAcceleration[i] <= 0.0 || limits.maxJerk[i] <= 0.0)
+        {
+            yError() << "Illegal limits for axis" << library.getAxes()[i];
+            return false;
+        }
+    }
+
+    trajectories.clear();
+
+    for (const auto & action : library.getActions())
+    {
+        const auto & trajectory = trajectories.emplace(action.name, plan(action)).first->second;
+
+        yDebug("Planned action %s: %zu segments, %.3f s (%.3f s if stopping at each waypoint)", std::string(action.name).c_str(),
+               trajectory.segments.size(), trajectory.getDuration(false), trajectory.getDuration(true));
+    }
+
+    return true;
+}
+
+const TrajectoryPlanner::Trajectory * TrajectoryPlanner::find(std::string_view name) const
+{
+    auto it = trajectories.find(name);
+    return it != trajectories.cend() ? &it->second : nullptr;
+}
+
+TrajectoryPlanner::Trajectory TrajectoryPlanner::plan(const MotionLibrary::Action & action) const
+{
+    std::vector<Profile> profiles;
+
+    for (auto k = 1; k < action.size; k++)
+    {
+        profiles.push_back(plan(action.waypoint(k - 1, numAxes), action.waypoint(k, numAxes)));
+    }
+
+    auto trajectory = Trajectory::fromProfiles(std::move(profiles), numAxes);
+
+    // via velocities, from the mean speeds of the rest-to-rest segments around each waypoint
+    for (auto k = 1; k + 1 < action.size; k++)
+    {
+        const double t0 = trajectory.segments[k - 1].duration;
+        const double t1 = trajectory.segments[k].duration;
+
+        if (t0 == 0.0 || t1 == 0.0)
+        {
+            continue; // repeated waypoint, stop there
+        }
+
+        const auto * prev = action.waypoint(k - 1, numAxes);
+        const auto * curr = action.waypoint(k, numAxes);
+        const auto * next = action.waypoint(k + 1, numAxes);
+        auto * v = trajectory.velocities.data() + k * numAxes;
+
+        for (auto i = 0; i < numAxes; i++)
+        {
+            const double m0 = (curr[i] - prev[i]) / t0;
+            const double m1 = (next[i] - curr[i]) / t1;
+
+            if (m0 * m1 > 0.0)
+            {
+                v[i] = std::abs(m0) < std::abs(m1) ? m0 : m1; // otherwise, the joint reverses or stops
+            }
+        }
+    }
+
+    // retime the segments that are entered or left in motion
+    for (auto k = 1; k < action.size; k++)
+    {
+        const auto * v0 = trajectory.velocity(k - 1, numAxes);
+        const auto * v1 = trajectory.velocity(k, numAxes);
+
+        if (isAtRest(v0, numAxes) && isAtRest(v1, numAxes))
+        {
+            continue;
+        }
+
+        const auto * q0 = action.waypoint(k - 1, numAxes);
+        const auto * q1 = action.waypoint(k, numAxes);
+        double duration = 0.0;
+
+        for (auto i = 0; i < numAxes; i++)
+        {
+            duration = std::max(duration, std::abs(q1[i] - q0[i]) / limits.maxSpeed[i]);
+        }
+
+        auto fitted = fit(q0, q1, v0, v1, duration);
+
+        if (!fitted)
+        {
+            yWarning("Unable to cross the waypoints of action %s within limits, stopping at each of them", std::string(action.name).c_str());
+
+            for (auto & segment : trajectory.segments)
+            {
+                segment.duration = segment.profile.getDuration();
+                segment.isBlended = false;
+            }
+
+            std::fill(trajectory.velocities.begin(), trajectory.velocities.end(), 0.0);
+            break;
+        }
+
+        auto & segment = trajectory.segments[k - 1];
+        segment.duration = *fitted;
+        segment.isBlended = true;
+    }
+
+    return trajectory;
+}
+
+std::optional<double> TrajectoryPlanner::fit(const double * q0, const double * q1, const double * v0, const double * v1, double duration) const
+{
+    constexpr double tolerance = 1.0 + 1e-9;
+    constexpr double margin = 1.0 + 1e-3; // the boundary velocities do not scale, hence approach from above
+    constexpr int maxIterations = 50;
+
+    duration = std::max(duration, 1e-3);
+
+    for (auto n = 0; n < maxIterations; n++)
+    {
+        const double k = getTimeScale(limits, numAxes, q0, q1, v0, v1, duration);
+
+        if (k <= tolerance)
+        {
+            return duration;
+        }
+
+        duration *= k * margin;
+    }
+
+    return std::nullopt; // e.g. a via velocity beyond the speed limit, or too much overshoot at these velocities
+}
+
+double TrajectoryPlanner::evaluate(double duration, double q0, double q1, double v0, double v1, double t, double * v)
+{
+    const Quintic p(duration, q0, q1, v0, v1);
+    const double s = std::clamp(t / duration, 0.0, 1.0);
+
+    if (v)
+    {
+        *v = (p.c1 + s * s * (3.0 * p.c3 + s * (4.0 * p.c4 + s * 5.0 * p.c5))) / duration;
+    }
+
+    return q0 + s * (p.c1 + s * s * (p.c3 + s * (p.c4 + s * p.c5)));
+}
+
+TrajectoryPlanner::Profile TrajectoryPlanner::plan(const double * q0, const double * q1) const
+{
+    // limits of the normalized path, set by the most constrained joint
+    double v = std::numeric_limits<double>::infinity();
+    double a = v;
+    double j = v;
+
+    for (auto i = 0; i < numAxes; i++)
+    {
+        if (double delta = std::abs(q1[i] - q0[i]); delta != 0.0)
+        {
+            v = std::min(v, limits.maxSpeed[i] / delta);
+            a = std::min(a, limits.maxAcceleration[i] / delta);
+            j = std::min(j, limits.maxJerk[i] / delta);
+        }
+    }
+
+    Profile p;
+
+    if (v == std::numeric_limits<double>::infinity())
+    {
+        return p; // already there
+    }
+
+    p.jerk = j;
+
+    // rest-to-rest double-S profile over a unit distance, see Biagiotti & Melchiorri (2008)
+    if (v * j >= a * a)
+    {
+        p.tj = a / j;
+        p.ta = p.tj + v / a;
+    }
+    else
+    {
+        p.tj = std::sqrt(v / j);
+        p.ta = 2.0 * p.tj;
+    }
+
+    p.tv = 1.0 / v - p.ta;
+
+    if (p.tv < 0.0)
+    {
+        // peak speed not reached
+        p.tv = 0.0;
+        p.tj = a / j;
+        p.ta = (a / j + std::sqrt(a * a / (j * j) + 4.0 / a)) / 2.0;
+
+        if (p.ta < 2.0 * p.tj)
+        {
+            // peak acceleration not reached either
+            p.tj = std::cbrt(1.0 / (2.0 * j));
+            p.ta = 2.0 * p.tj;
+        }
+    }
+
+    return p;
+}
+
+int TrajectoryPlanner::getReferences(const Profile & profile, const double * q0, const double * q1,
+                                     int * indices, double * speeds, double * accelerations, double * targets) const
+{
+    int n = 0;
+
+    for (auto i = 0; i < numAxes; i++)
+    {
+        if (double delta = std::abs(q1[i] - q0[i]); delta != 0.0)
+        {
+            // synchronized motion, limited by the most constrained joint
+            indices[n] = i;
+            speeds[n] = profile.getPeakSpeed() * delta;
+            accelerations[n] = profile.getPeakAcceleration() * delta;
+            targets[n] = q1[i];
+            n++;
+        }
+    }
+
+    return n;
+}
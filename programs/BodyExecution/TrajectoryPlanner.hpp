@@ -0,0 +1,127 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __TRAJECTORY_PLANNER_HPP__
+#define __TRAJECTORY_PLANNER_HPP__
+
+#include <cstddef>
+
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "MotionLibrary.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Minimum-time, jerk-limited planner for synchronized point-to-point joint motions.
+ *
+ * All joints follow a straight line in joint space, q(t) = q0 + s(t) * (q1 - q0), where s(t) is a
+ * rest-to-rest double-S profile whose normalized limits are those of the most constrained joint.
+ * Hence every joint starts and stops at the same time and respects its own speed, acceleration
+ * and jerk limits.
+ *
+ * Actions are planned once at load time as a whole: each intermediate waypoint is crossed with a
+ * via velocity, per joint the smaller of the mean speeds of its adjacent segments, or zero where the
+ * joint reverses or stops. Segments that depart or arrive with some velocity follow a quintic
+ * polynomial per joint (zero acceleration at both ends), timed to respect the limits, otherwise the
+ * whole action stops at each waypoint. Segments between rests keep the straight double-S path. The rest-to-rest profile of every segment is kept
+ * too, for controllers that come to a stop at each waypoint.
+ */
+class TrajectoryPlanner
+{
+public:
+    struct Limits
+    {
+        std::vector<double> maxSpeed; // [deg/s]
+        std::vector<double> maxAcceleration; // [deg/s^2]
+        std::vector<double> maxJerk; // [deg/s^3]
+    };
+
+    //! Normalized profile, s(t) goes from 0 to 1.
+    struct Profile
+    {
+        double tj {0.0}; // duration of constant jerk phases [s]
+        double ta {0.0}; // duration of acceleration (and deceleration) [s]
+        double tv {0.0}; // duration of constant speed [s]
+        double jerk {0.0}; // [1/s^3]
+
+        double getDuration() const
+        { return 2 * ta + tv; }
+
+        double getPeakSpeed() const // [1/s], the unit distance is covered in ta + tv at this speed
+        { return ta + tv > 0.0 ? 1.0 / (ta + tv) : 0.0; }
+
+        double getPeakAcceleration() const // [1/s^2]
+        { return jerk * tj; }
+
+        double evaluate(double t) const;
+
+        //! Same path, slowed down to last the given time (not shorter than getDuration()).
+        Profile stretch(double duration) const;
+
+        //! Constant speed, no acceleration phases (meant for densely sampled paths).
+        static Profile linear(double duration)
+        { Profile p; p.tv = duration; return p; }
+    };
+
+    //! Motion between two consecutive waypoints.
+    struct Segment
+    {
+        Profile profile; // rest-to-rest, as followed by controllers that stop at each waypoint
+        double duration {0.0}; // [s], when crossing the waypoints with the via velocities
+        bool isBlended {false}; // quintic through the via velocities, otherwise follows the profile
+    };
+
+    //! Timing of all segments of an action.
+    struct Trajectory
+    {
+        std::vector<Segment> segments; // waypoints - 1 elements
+        std::vector<double> velocities; // [deg/s], numAxes per waypoint, zero at both ends
+
+        const double * velocity(std::size_t i, std::size_t numAxes) const
+        { return velocities.data() + i * numAxes; }
+
+        //! Time from the first to the last waypoint [s], crossing via points or stopping at each.
+        double getDuration(bool stopAtWaypoints) const;
+
+        //! Stop at each waypoint along the given profiles, e.g. for uploaded trajectories.
+        static Trajectory fromProfiles(std::vector<Profile> profiles, std::size_t numAxes);
+    };
+
+    bool configure(const MotionLibrary & library, const Limits & limits);
+
+    Profile plan(const double * q0, const double * q1) const;
+
+    //! Joints that move from q0 to q1 along the profile, along with their synchronized reference speeds and
+    //! accelerations. Returns how many, each output array must have room for all axes.
+    int getReferences(const Profile & profile, const double * q0, const double * q1,
+                      int * indices, double * speeds, double * accelerations, double * targets) const;
+
+    //! Duration of the quintic segments of a trajectory for all joints, starting from the given one and
+    //! lengthened as required by the most constrained joint until every limit holds [s]. Empty if none found.
+    std::optional<double> fit(const double * q0, const double * q1, const double * v0, const double * v1, double duration) const;
+
+    //! Position of a joint along a quintic segment with zero boundary accelerations, speed is optional.
+    static double evaluate(double duration, double q0, double q1, double v0, double v1, double t, double * v = nullptr);
+
+    //! Precomputed trajectory of a library action, null if not found.
+    const Trajectory * find(std::string_view name) const;
+
+    const Limits & getLimits() const
+    { return limits; }
+
+private:
+    Trajectory plan(const MotionLibrary::Action & action) const;
+
+    std::size_t numAxes {0};
+    Limits limits;
+    std::unordered_map<std::string_view, Trajectory> trajectories; // keyed by action name
+};
+
+} // namespace roboticslab
+
+#endif // __TRAJECTORY_PLANNER_HPP__
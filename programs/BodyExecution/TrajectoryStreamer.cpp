@@ -0,0 +1,351 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "TrajectoryStreamer.hpp"
+
+#include <cmath> // std::abs
+
+#include <algorithm> // std::any_of, std::max
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/SystemClock.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    // straight line in joint space, v is optional
+    void interpolate(const TrajectoryPlanner::Profile & profile, const std::vector<double> & q0, const std::vector<double> & q1,
+                     double t, std::vector<double> & q, std::vector<double> * v)
+    {
+        const double s = profile.evaluate(t);
+
+        for (auto i = 0; i < q.size(); i++)
+        {
+            q[i] = q0[i] + s * (q1[i] - q0[i]);
+        }
+
+        if (v)
+        {
+            // numerical derivative, only needed when replanning
+            constexpr double dt = 1e-3;
+            const double ds = (profile.evaluate(t + dt) - profile.evaluate(t - dt)) / (2.0 * dt);
+
+            for (auto i = 0; i < v->size(); i++)
+            {
+                (*v)[i] = ds * (q1[i] - q0[i]);
+            }
+        }
+    }
+
+    template <typename Segment>
+    void evaluate(const Segment & segment, double t, std::vector<double> & q, std::vector<double> * v)
+    {
+        if (!segment.isBlended)
+        {
+            interpolate(segment.profile, segment.q0, segment.q1, t, q, v);
+            return;
+        }
+
+        for (auto i = 0; i < q.size(); i++)
+        {
+            q[i] = TrajectoryPlanner::evaluate(segment.duration, segment.q0[i], segment.q1[i], segment.v0[i], segment.v1[i], t,
+                                               v ? &(*v)[i] : nullptr);
+        }
+    }
+}
+
+TrajectoryStreamer::TrajectoryStreamer(double period, const TrajectoryPlanner & _planner)
+    : yarp::os::PeriodicThread(period, yarp::os::PeriodicThreadClock::Absolute),
+      planner(_planner)
+{}
+
+bool TrajectoryStreamer::configure(JointStateCache * _stateCache, yarp::dev::IPositionDirect * _iPositionDirect, std::size_t _numAxes)
+{
+    stateCache = _stateCache;
+    iPositionDirect = _iPositionDirect;
+    numAxes = _numAxes;
+    command.resize(numAxes);
+    return stateCache && iPositionDirect && numAxes != 0;
+}
+
+bool TrajectoryStreamer::execute(const MotionLibrary::Action * action, int id, ActionCommand::Policy policy,
+                                 const TrajectoryPlanner::Trajectory * trajectory)
+{
+    return commands.push({ActionCommand::Type::Execute, action, id, policy, trajectory});
+}
+
+bool TrajectoryStreamer::abort()
+{
+    return commands.push({ActionCommand::Type::Stop});
+}
+
+bool TrajectoryStreamer::plan(const ActionCommand & request)
+{
+    const auto * action = request.action;
+    const auto * trajectory = request.trajectory;
+    std::vector<double> q(numAxes);
+    std::vector<double> v(numAxes, 0.0);
+
+    if (hasCommand && currentSegment < segments.size())
+    {
+        // blend from the current state of the trajectory being replaced
+        auto t = yarp::os::SystemClock::nowSystem() - segmentStart;
+        evaluate(segments[currentSegment], t, q, &v);
+    }
+    else if (hasCommand)
+    {
+        q = command;
+    }
+    else if (!stateCache->getEncoders(q.data()))
+    {
+        yWarning() << "Failed to get current encoder values";
+        return false;
+    }
+
+    segments.clear();
+    segments.reserve(action->size);
+
+    const auto * first = action->waypoint(0, numAxes);
+    auto & approach = segments.emplace_back();
+
+    approach.q0 = q;
+    approach.q1.assign(first, first + numAxes);
+
+    if (std::any_of(v.cbegin(), v.cend(), [](auto value) { return value != 0.0; }))
+    {
+        const auto & limits = planner.getLimits();
+        const auto * v1 = trajectory->velocity(0, numAxes); // at rest
+        double duration = getPeriod();
+
+        for (auto i = 0; i < numAxes; i++)
+        {
+            duration = std::max(duration, std::abs(approach.q1[i] - approach.q0[i]) / limits.maxSpeed[i]);
+        }
+
+        auto fitted = planner.fit(approach.q0.data(), approach.q1.data(), v.data(), v1, duration);
+
+        if (!fitted)
+        {
+            yWarning() << "Unable to blend into action" << action->name << "within limits";
+            return false;
+        }
+
+        approach.v0 = v;
+        approach.v1.assign(v1, v1 + numAxes);
+        approach.duration = *fitted;
+        approach.isBlended = true;
+    }
+    else
+    {
+        approach.profile = planner.plan(approach.q0.data(), approach.q1.data());
+        approach.duration = approach.profile.getDuration();
+    }
+
+    // remaining segments were planned beforehand
+    for (auto k = 1; k < action->size; k++)
+    {
+        const auto * waypoint = action->waypoint(k, numAxes);
+        const auto & planned = trajectory->segments[k - 1];
+        auto & segment = segments.emplace_back();
+
+        segment.q0 = segments[k - 1].q1;
+        segment.q1.assign(waypoint, waypoint + numAxes);
+        segment.profile = planned.profile;
+        segment.duration = planned.duration;
+        segment.isBlended = planned.isBlended;
+
+        if (segment.isBlended)
+        {
+            const auto * v0 = trajectory->velocity(k - 1, numAxes);
+            const auto * v1 = trajectory->velocity(k, numAxes);
+            segment.v0.assign(v0, v0 + numAxes);
+            segment.v1.assign(v1, v1 + numAxes);
+        }
+    }
+
+    currentSegment = 0;
+    segmentStart = yarp::os::SystemClock::nowSystem();
+    return true;
+}
+
+bool TrajectoryStreamer::startAction(const ActionCommand & command)
+{
+    currentAction = command.action;
+    currentId = command.id;
+
+    if (!plan(command)) // blends from the previous trajectory, if still in progress
+    {
+        segments.clear();
+        finishedId = currentId;
+
+        if (abortCallback)
+        {
+            abortCallback(currentAction, currentId);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void TrajectoryStreamer::abortAll()
+{
+    if (!segments.empty())
+    {
+        finishedId = currentId;
+
+        if (abortCallback)
+        {
+            abortCallback(currentAction, currentId);
+        }
+    }
+
+    for (const auto & command : pending)
+    {
+        finishedId = command.id;
+
+        if (abortCallback)
+        {
+            abortCallback(command.action, command.id);
+        }
+    }
+
+    pending.clear();
+}
+
+bool TrajectoryStreamer::processCommands()
+{
+    ActionCommand command;
+    bool started = false;
+
+    while (commands.pop(command))
+    {
+        if (command.type == ActionCommand::Type::Stop)
+        {
+            abortAll();
+            segments.clear();
+            started = false;
+        }
+        else
+        {
+            takenId = command.id;
+
+            if (command.policy == ActionCommand::Policy::Replace)
+            {
+                abortAll(); // keeps segments, replanning departs from the current state
+                started = startAction(command);
+            }
+            else if (segments.empty())
+            {
+                started = startAction(command);
+            }
+            else
+            {
+                pending.push_back(command);
+            }
+        }
+
+        publishStatus();
+    }
+
+    return started;
+}
+
+void TrajectoryStreamer::publishStatus()
+{
+    status = {takenId, segments.empty() ? takenId : finishedId};
+}
+
+void TrajectoryStreamer::run()
+{
+    bool started = processCommands();
+
+    if (segments.empty())
+    {
+        return;
+    }
+
+    const auto * action = currentAction;
+    int id = currentId;
+    auto t = yarp::os::SystemClock::nowSystem() - segmentStart;
+    auto firstSegment = currentSegment;
+
+    while (currentSegment < segments.size() && t >= segments[currentSegment].duration)
+    {
+        t -= segments[currentSegment].duration;
+        segmentStart += segments[currentSegment].duration;
+        currentSegment++;
+    }
+
+    auto lastSegment = currentSegment;
+    bool isLastWaypoint = currentSegment == segments.size();
+    bool isBlending = false;
+
+    if (!isLastWaypoint && currentSegment + 1 == segments.size() && !pending.empty()
+        && pending.front().policy == ActionCommand::Policy::Blend)
+    {
+        const auto & segment = segments[currentSegment];
+        isBlending = t >= segment.duration - (segment.isBlended ? segment.duration / 2 : segment.profile.ta);
+    }
+
+    bool chained = false;
+
+    if (isLastWaypoint || isBlending)
+    {
+        // current action is done, continue with the next one (if any) in the same cycle
+        finishedId = id;
+        lastSegment = segments.size();
+
+        if (isLastWaypoint)
+        {
+            command = segments.back().q1;
+            segments.clear();
+        }
+
+        while (!chained && !pending.empty())
+        {
+            auto next = pending.front();
+            pending.pop_front();
+            chained = startAction(next);
+        }
+
+        if (!chained)
+        {
+            segments.clear();
+        }
+
+        publishStatus();
+    }
+
+    if (!segments.empty())
+    {
+        evaluate(segments[currentSegment], yarp::os::SystemClock::nowSystem() - segmentStart, command, nullptr);
+    }
+
+    if (!iPositionDirect->setPositions(command.data()))
+    {
+        yWarning() << "Failed to stream position references";
+    }
+
+    hasCommand = true;
+
+    // notify once the reference has been sent
+    if (started && startCallback)
+    {
+        startCallback(action, id);
+    }
+
+    if (waypointCallback)
+    {
+        for (auto i = firstSegment; i < lastSegment; i++)
+        {
+            waypointCallback(action, id, i);
+        }
+    }
+
+    if (chained && startCallback)
+    {
+        startCallback(currentAction, currentId);
+    }
+}
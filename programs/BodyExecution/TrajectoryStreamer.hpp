@@ -0,0 +1,118 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __TRAJECTORY_STREAMER_HPP__
+#define __TRAJECTORY_STREAMER_HPP__
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <yarp/os/PeriodicThread.h>
+
+#include <yarp/dev/IPositionDirect.h>
+
+#include "ActionCommand.hpp"
+#include "JointStateCache.hpp"
+#include "MotionLibrary.hpp"
+#include "TrajectoryPlanner.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Streams interpolated joint references through IPositionDirect at a fixed rate.
+ *
+ * Waypoints are joined by the trajectories precomputed by TrajectoryPlanner, which cross the via
+ * points without stopping. Uploaded actions bring their own trajectories instead. Only the approach
+ * to the first waypoint is planned online. If an action replaces another one in motion, or is
+ * blended into it, that approach is a quintic segment that departs with the current velocity.
+ * Blending starts as soon as the previous action begins to decelerate towards its last waypoint.
+ */
+class TrajectoryStreamer : public yarp::os::PeriodicThread
+{
+public:
+    //! Invoked from the streaming thread once the first reference of a new action has been sent.
+    using StartCallback = std::function<void(const MotionLibrary::Action * action, int id)>;
+
+    //! Invoked from the streaming thread on each waypoint reached.
+    using WaypointCallback = std::function<void(const MotionLibrary::Action * action, int id, std::size_t waypoint)>;
+
+    //! Invoked from the streaming thread if an action is replaced, stopped or cannot be planned.
+    using AbortCallback = std::function<void(const MotionLibrary::Action * action, int id)>;
+
+    TrajectoryStreamer(double period, const TrajectoryPlanner & planner);
+
+    bool configure(JointStateCache * stateCache, yarp::dev::IPositionDirect * iPositionDirect, std::size_t numAxes);
+
+    void setStartCallback(const StartCallback & callback)
+    { startCallback = callback; }
+
+    void setWaypointCallback(const WaypointCallback & callback)
+    { waypointCallback = callback; }
+
+    void setAbortCallback(const AbortCallback & callback)
+    { abortCallback = callback; }
+
+    //! Queue an action according to the given policy (called from a different thread, never blocks).
+    bool execute(const MotionLibrary::Action * action, int id, ActionCommand::Policy policy,
+                 const TrajectoryPlanner::Trajectory * trajectory);
+
+    //! Hold the last commanded position and discard queued actions (called from a different thread, never blocks).
+    bool abort();
+
+    //! Run a single cycle from a different thread, if not started.
+    void step()
+    { run(); }
+
+    ActionStatus getStatus() const
+    { return status.load(); }
+
+protected:
+    void run() override;
+
+private:
+    struct Segment
+    {
+        double duration; // [s]
+        std::vector<double> q0, q1; // [deg]
+        std::vector<double> v0, v1; // [deg/s], only for a blended segment (otherwise, use the profile)
+        TrajectoryPlanner::Profile profile;
+        bool isBlended { false };
+    };
+
+    bool plan(const ActionCommand & request);
+    bool startAction(const ActionCommand & command);
+    void abortAll();
+    bool processCommands();
+    void publishStatus();
+
+    const TrajectoryPlanner & planner;
+
+    JointStateCache * stateCache { nullptr };
+    yarp::dev::IPositionDirect * iPositionDirect { nullptr };
+    std::size_t numAxes { 0 };
+    StartCallback startCallback;
+    WaypointCallback waypointCallback;
+    AbortCallback abortCallback;
+
+    ActionQueue commands;
+    std::atomic<ActionStatus> status { ActionStatus{} };
+
+    // accessed from the periodic thread only
+    const MotionLibrary::Action * currentAction { nullptr };
+    int currentId { 0 };
+    std::deque<ActionCommand> pending;
+    int takenId { 0 };
+    int finishedId { 0 };
+    std::vector<Segment> segments;
+    std::size_t currentSegment { 0 };
+    double segmentStart { 0.0 };
+    bool hasCommand { false };
+    std::vector<double> command;
+};
+
+} // namespace roboticslab
+
+#endif // __TRAJECTORY_STREAMER_HPP__
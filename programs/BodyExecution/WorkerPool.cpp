@@ -0,0 +1,88 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "WorkerPool.hpp"
+
+using namespace roboticslab;
+
+WorkerPool::WorkerPool(std::size_t numThreads)
+{
+    // the caller of run() is a worker as well
+    for (auto i = 1; i < numThreads; i++)
+    {
+        threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    startCond.notify_all();
+
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::runBatch(std::size_t n, const void * context, invoke_t invoke)
+{
+    {
+        std::lock_guard lock(mutex);
+        batchContext = context;
+        batchInvoke = invoke;
+        batchSize = n;
+        nextTask = 0;
+        busy = threads.size();
+        generation++;
+    }
+
+    startCond.notify_all();
+    drain();
+
+    std::unique_lock lock(mutex);
+    doneCond.wait(lock, [this] { return busy == 0; });
+    batchContext = nullptr;
+    batchInvoke = nullptr;
+}
+
+void WorkerPool::work()
+{
+    unsigned int seen = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex);
+            startCond.wait(lock, [this, seen] { return stopping || generation != seen; });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            seen = generation;
+        }
+
+        drain();
+
+        {
+            std::lock_guard lock(mutex);
+            busy--;
+        }
+
+        doneCond.notify_one();
+    }
+}
+
+void WorkerPool::drain()
+{
+    // tasks are claimed one by one, so that uneven loads are balanced across threads
+    for (auto i = nextTask++; i < batchSize; i = nextTask++)
+    {
+        batchInvoke(batchContext, i);
+    }
+}
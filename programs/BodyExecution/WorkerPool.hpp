@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __WORKER_POOL_HPP__
+#define __WORKER_POOL_HPP__
+
+#include <cstddef>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Fixed set of threads that run batches of independent tasks.
+ */
+class WorkerPool
+{
+public:
+    explicit WorkerPool(std::size_t numThreads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool & operator=(const WorkerPool &) = delete;
+
+    //! Invoke task(i) for i in [0, n) and wait for all of them, the calling thread takes part too.
+    template <typename Task>
+    void run(std::size_t n, Task && task)
+    {
+        // task outlives the batch, hence referenced rather than copied (no allocation)
+        runBatch(n, &task, [](const void * context, std::size_t i) { (*static_cast<const std::remove_reference_t<Task> *>(context))(i); });
+    }
+
+private:
+    using invoke_t = void (*)(const void * context, std::size_t i);
+
+    void runBatch(std::size_t n, const void * context, invoke_t invoke);
+    void work();
+    void drain();
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable startCond;
+    std::condition_variable doneCond;
+    bool stopping {false};
+    unsigned int generation {0};
+    std::size_t busy {0};
+
+    // current batch
+    const void * batchContext {nullptr};
+    invoke_t batchInvoke {nullptr};
+    std::size_t batchSize {0};
+    std::atomic<std::size_t> nextTask {0};
+};
+
+} // namespace roboticslab
+
+#endif // __WORKER_POOL_HPP__
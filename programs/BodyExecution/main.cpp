@@ -11,6 +11,8 @@
 #include <yarp/os/ResourceFinder.h>
 
 #include "BodyExecution.hpp"
+#include "BodyExecutionHost.hpp"
+#include "MotionLibrary.hpp"
 
 int main(int argc, char * argv[])
 {
@@ -26,6 +28,23 @@ int main(int argc, char * argv[])
         return mod.runModule(rf);
     }
 
+    if (rf.check("compile"))
+    {
+        // offline step, no YARP network required
+        roboticslab::MotionLibrary library;
+        auto source = rf.findFileByName(rf.check("library", yarp::os::Value("motions.ini")).asString());
+        auto target = rf.find("compile").asString();
+
+        if (!library.fromConfigFile(source) || !library.toBinaryFile(target))
+        {
+            yError() << "Unable to compile motion library" << source << "into" << target;
+            return 1;
+        }
+
+        yInfo() << "Compiled" << library.getNumActions() << "actions from" << source << "into" << target;
+        return 0;
+    }
+
     yInfo("Run \"%s --help\" for options", argv[0]);
     yInfo("%s checking for yarp network...", argv[0]);
 
@@ -37,5 +56,11 @@ int main(int argc, char * argv[])
         return 1;
     }
 
+    if (rf.check("robots"))
+    {
+        roboticslab::BodyExecutionHost host;
+        return host.runModule(rf);
+    }
+
     return mod.runModule(rf);
 }
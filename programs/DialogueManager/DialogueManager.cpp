@@ -2,8 +2,15 @@
 
 #include "DialogueManager.hpp"
 
-#include <array>
+#include <algorithm> // std::find_if, std::max, std::min, std::none_of
+#include <chrono>
 #include <exception>
+#include <fstream>
+#include <memory> // std::atomic_load, std::atomic_store
+#include <string> // std::to_string
+#include <unordered_set>
+#include <utility> // std::pair
+#include <vector>
 
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Property.h>
@@ -14,79 +21,145 @@ using namespace roboticslab;
 namespace
 {
     class ThreadTerminator : public std::exception {};
-
-    const std::array sentenceLabels = {
-        "presentation_01",
-        "presentation_02",
-        "composition_01",
-        "composition_02",
-        "composition_03",
-        "composition_04",
-        "composition_05_01",
-        "composition_05_02",
-        "composition_05_03",
-        "composition_06",
-        "composition_07",
-        "purpose_01",
-        "purpose_02",
-        "ending_01",
-    };
 }
 
 constexpr auto DEFAULT_PREFIX = "/dialogueManager";
 constexpr auto DEFAULT_LANGUAGE = "spanish";
 constexpr auto DEFAULT_BACKEND = "espeak";
+constexpr auto DEFAULT_LANGUAGES = "english spanish";
+constexpr auto DEFAULT_TIMELINE = "presentation.timeline";
+constexpr auto DEFAULT_STATS_FILE = "presentation-stats.csv";
+constexpr auto DEFAULT_RESULTS_FILE = "benchmark-results.ini";
+constexpr auto DEFAULT_TOLERANCE = 0.1;
+constexpr auto DEFAULT_MOTION_LEAD = 0.0; // [s]
+constexpr auto MOTION_EVENT_TIMEOUT = 2.0; // [s] without events, then ask bodyExecution in case one was lost
 
 bool DialogueManager::configure(yarp::os::ResourceFinder & rf)
 {
     auto language = rf.check("language", yarp::os::Value(DEFAULT_LANGUAGE), "language to be used").asString();
     auto backend = rf.check("backend", yarp::os::Value(DEFAULT_BACKEND), "TTS backend").asString();
+    statsPath = rf.check("stats", yarp::os::Value(DEFAULT_STATS_FILE), "CSV file for latency statistics").asString();
+    resultsPath = rf.check("benchmarkResults", yarp::os::Value(DEFAULT_RESULTS_FILE), "benchmark results file").asString();
+    baselinePath = rf.check("baseline", yarp::os::Value(""), "benchmark baseline file").asString();
+    tolerance = rf.check("tolerance", yarp::os::Value(DEFAULT_TOLERANCE), "allowed relative regression").asFloat64();
+    benchmark = rf.check("benchmark");
+    auto timelineFile = rf.check("timeline", yarp::os::Value(DEFAULT_TIMELINE), "presentation timeline").asString();
+    cacheDir = rf.check("cache", yarp::os::Value(""), "speech cache directory").asString();
+    motionLead = rf.check("motionLead", yarp::os::Value(DEFAULT_MOTION_LEAD), "time to send anchored motions ahead of their mark [s]").asFloat64();
+
+    yarp::os::Bottle languages(DEFAULT_LANGUAGES);
+
+    if (rf.check("languages"))
+    {
+        const auto & value = rf.find("languages");
+        languages = value.isList() ? *value.asList() : yarp::os::Bottle(value.asString());
+    }
 
     if (rf.check("help"))
     {
         yInfo("DialogueManager options:");
         yInfo("\t--help (this help)\t--from [file.ini]\t--context [path]");
-        yInfo("\t--language: %s [%s]", language.c_str(), DEFAULT_LANGUAGE);
-        yInfo("\t--backend: %s [%s]", backend.c_str(), DEFAULT_BACKEND);
+        yInfo("\t--language: %s [%s] (initially, others may be selected at runtime)", language.c_str(), DEFAULT_LANGUAGE);
+        yInfo("\t--backend: %s [%s] (initially, others may be selected at runtime)", backend.c_str(), DEFAULT_BACKEND);
+        yInfo("\t--languages: %s [(%s)] (loaded at startup, along with --language)", languages.toString().c_str(), DEFAULT_LANGUAGES);
         yInfo("\t--model: (specific for the chosen language and backend)");
+        yInfo("\t--cache: [path] (play pre-synthesized speech from this directory)");
+        yInfo("\t--render: (command line that synthesizes {input} into {output} with {model})");
+        yInfo("\t--timeline: %s [%s]", timelineFile.c_str(), DEFAULT_TIMELINE);
+        yInfo("\t--motionLead: %f [%f]", motionLead, DEFAULT_MOTION_LEAD);
+        yInfo("\t--stats: %s [%s]", statsPath.c_str(), DEFAULT_STATS_FILE);
+        yInfo("\t--benchmark (run the presentation once, then exit)");
+        yInfo("\t--benchmarkResults: %s [%s]", resultsPath.c_str(), DEFAULT_RESULTS_FILE);
+        yInfo("\t--baseline: [file.ini] (fail if results exceed it)");
+        yInfo("\t--tolerance: %f [%f]", tolerance, DEFAULT_TOLERANCE);
         return false;
     }
 
-    yarp::os::Property config;
-    auto path = rf.findFileByName(language + ".ini");
-
-    if (!config.fromConfigFile(path)) {
-        yError() << "Unable to open configuration file for language" << language;
+    if (!timeline.fromFile(rf.findFileByName(timelineFile)))
+    {
         return false;
     }
 
-    const auto & group = config.findGroup(backend);
+    defaultLanguage = language;
+    defaultBackend = backend;
+    modelOverride = rf.check("model", yarp::os::Value(""), "voice model").asString();
+    renderOverride = rf.check("render", yarp::os::Value(""), "render command").asString();
+
+    // each language file is resolved like any other context file, then watched by updateModule
+    std::vector<std::string> names {language};
 
-    if (group.isNull())
+    for (auto i = 0; i < languages.size(); i++)
     {
-        yError() << "Backend" << backend << "for language" << language << "not found";
-        return false;
+        names.push_back(languages.get(i).asString());
+    }
+
+    for (const auto & name : names)
+    {
+        auto path = rf.findFileByName(name + ".ini");
+
+        if (path.empty())
+        {
+            if (name == language)
+            {
+                yError() << "Unable to find language file" << name + ".ini";
+                return false;
+            }
+
+            yWarning() << "Unable to find language file" << name + ".ini" << "(skipping)";
+            continue;
+        }
+
+        if (std::none_of(languageFiles.cbegin(), languageFiles.cend(), [&path](const auto & file) { return file.path == path; }))
+        {
+            std::error_code ec;
+            languageFiles.push_back({path, std::filesystem::last_write_time(path, ec)});
+        }
     }
 
-    if (!group.check("model"))
+    auto start = yarp::os::SystemClock::nowSystem();
+    auto table = std::make_shared<SentenceTable>();
+
+    // a broken file only drops its own voices, which is fatal for the chosen one alone
+    loadLanguages(*table);
+
+    const auto * voice = table->find(language, backend);
+
+    if (!voice)
     {
-        yError() << "Backend" << backend << "for language" << language << "does not have a voice model";
+        yError() << "Backend" << backend << "for language" << language << "not found or incomplete";
         return false;
     }
 
-    model = rf.check("model", group.find("model"), "voice model").asString();
+    yInfo("Loaded %zu voices from %zu language files in %.3f ms: %zu unique strings, %zu bytes", table->voices.size(), languageFiles.size(),
+          (yarp::os::SystemClock::nowSystem() - start) * 1e3, table->strings.getNumStrings(), table->strings.getBytes());
 
-    for (const auto & label : sentenceLabels)
+    selectedLanguage = language;
+    selectedBackend = backend;
+    sentences = table;
+
+    if (!cacheDir.empty())
     {
-        const auto & value = group.find(label);
+        if (!voice->hasCache)
+        {
+            yError() << "Unable to set up speech cache for backend" << backend << "of language" << language;
+            return false;
+        }
+
+        if (!audioPort.open(std::string(DEFAULT_PREFIX) + "/audio:o"))
+        {
+            yError() << "Unable to open audio port" << audioPort.getName();
+            return false;
+        }
 
-        if (!value.isString())
+        if (!audioControlPort.open(std::string(DEFAULT_PREFIX) + "/audio/rpc:c"))
         {
-            yError() << "Backend" << backend << "for language" << language << "does not have sentence" << label;
+            yError() << "Unable to open audio control port" << audioControlPort.getName();
             return false;
         }
 
-        sentences[label] = value.asString();
+        useCache = true;
+        renderStop = false;
+        renderThread = std::thread(&DialogueManager::renderSentences, this);
     }
 
     if (!speechPort.open(std::string(DEFAULT_PREFIX) + "/tts/rpc:c"))
@@ -95,16 +168,37 @@ bool DialogueManager::configure(yarp::os::ResourceFinder & rf)
         return false;
     }
 
+    if (!commandPort.open(std::string(DEFAULT_PREFIX) + "/rpc:s"))
+    {
+        yError() << "Unable to open RPC command port" << commandPort.getName();
+        return false;
+    }
+
+    if (!timingPort.open(std::string(DEFAULT_PREFIX) + "/tts/timing/rpc:c"))
+    {
+        yError() << "Unable to open RPC TTS timing port" << timingPort.getName();
+        return false;
+    }
+
     if (!motionPort.open(std::string(DEFAULT_PREFIX) + "/motion/rpc:c"))
     {
         yError() << "Unable to open RPC motion port" << motionPort.getName();
         return false;
     }
 
+    if (!motionStatePort.open(std::string(DEFAULT_PREFIX) + "/motion/state:i"))
+    {
+        yError() << "Unable to open motion state port" << motionStatePort.getName();
+        return false;
+    }
+
+    motionStatePort.useCallback(*this);
+
     tts.yarp().attachAsClient(speechPort);
+    timing.yarp().attachAsClient(timingPort);
     motion.yarp().attachAsClient(motionPort);
 
-    return true;
+    return commands.yarp().attachAsServer(commandPort);
 }
 
 double DialogueManager::getPeriod()
@@ -116,6 +210,8 @@ bool DialogueManager::updateModule()
 {
     static const auto throttle = 1.0; // [s]
 
+    reloadLanguages();
+
     if (speechPort.getOutputCount() == 0)
     {
         if (yarp::os::Thread::isRunning())
@@ -150,6 +246,11 @@ bool DialogueManager::updateModule()
                 return false;
             }
         }
+        else if (benchmark)
+        {
+            yInfo() << "Benchmark finished";
+            return false;
+        }
         else
         {
             yDebugThrottle(throttle) << "Presentation has ended, reconnect TTS port" << speechPort.getName() << "to start again";
@@ -161,19 +262,76 @@ bool DialogueManager::updateModule()
 
 bool DialogueManager::interruptModule()
 {
+    commandPort.interrupt();
     return yarp::os::Thread::stop();
 }
 
 bool DialogueManager::close()
 {
+    renderStop = true;
+
+    if (renderThread.joinable())
+    {
+        renderThread.join();
+    }
+
+    audioPort.close();
+    audioControlPort.close();
+    commandPort.close();
     speechPort.close();
+    timingPort.close();
     motionPort.close();
+    motionStatePort.disableCallback();
+    motionStatePort.close();
     return true;
 }
 
 bool DialogueManager::threadInit()
 {
-    if (!tts.setLanguage(model))
+    {
+        std::lock_guard lock(motionStateMutex);
+        motionsRequested = 0;
+        pendingMotions.clear();
+        lastMotionDone = 0.0;
+        markedMotionId = 0;
+    }
+
+    latencies.clear();
+
+    // histograms of bodyExecution would otherwise add up across runs
+    if (motionPort.getOutputCount() > 0 && !motion.resetStats())
+    {
+        yWarning() << "Unable to reset motion statistics";
+    }
+
+    pendingSentence.clear();
+    playbackEnd = 0.0;
+    cachedPlays = 0;
+    prefetched = {};
+    spokenSentence = nullptr;
+    runCount++;
+
+    lastSpeechStart = lastMotionStart = 0.0;
+    lastSpeechDone = totalSpeechGap = totalMotionIdle = 0.0;
+    sayCalls = checkSayDoneCalls = checkMotionDoneCalls = 0;
+
+    {
+        std::lock_guard lock(languageMutex);
+        runLanguage = selectedLanguage;
+        runBackend = selectedBackend;
+    }
+
+    auto voice = findVoice(getSentences(), runLanguage, runBackend);
+
+    if (!voice)
+    {
+        yError() << "Backend" << runBackend << "for language" << runLanguage << "is no longer available";
+        return false;
+    }
+
+    yInfo() << "Presenting in" << runLanguage << "with backend" << runBackend;
+
+    if (const auto model = std::string(voice->model); !tts.setLanguage(model))
     {
         yError() << "Unable to set model to" << model;
         return false;
@@ -184,11 +342,38 @@ bool DialogueManager::threadInit()
 
 void DialogueManager::threadRelease()
 {
+    auto histograms = latencies.getHistograms();
+
+    if (motionPort.getOutputCount() > 0)
+    {
+        auto motionHistograms = motion.getStats();
+        histograms.insert(histograms.end(), motionHistograms.cbegin(), motionHistograms.cend());
+    }
+
+    if (LatencyStatistics::appendToCsv(statsPath, runCount, histograms))
+    {
+        yInfo() << "Latency statistics of run" << runCount << "appended to" << statsPath;
+    }
+
     if (!tts.stop())
     {
         yWarning() << "Unable to stop speech";
     }
 
+    if (playbackEnd > yarp::os::SystemClock::nowSystem())
+    {
+        // drop the rest of the cached utterance, the player keeps running for the next presentation
+        yarp::os::Bottle cmd, reply;
+        cmd.addString("clear");
+
+        if (audioControlPort.getOutputCount() == 0 || !audioControlPort.write(cmd, reply))
+        {
+            yWarning() << "Unable to interrupt cached speech";
+        }
+    }
+
+    playbackEnd = 0.0;
+
     if (!motion.stop())
     {
         yWarning() << "Unable to stop motion";
@@ -197,114 +382,684 @@ void DialogueManager::threadRelease()
 
 void DialogueManager::run()
 {
-    yInfo() << "Presentation start";
-
     try
     {
-        speak("presentation_01");
-        motion.doGreet();
-        awaitMotionCompletion();
-        motion.doHoming();
-        awaitSpeechAndMotionCompletion();
+        awaitMotionReady();
 
-        yarp::os::SystemClock::delaySystem(0.5);
+        if (!checkTimelineActions())
+        {
+            yError() << "Presentation not started, fix the timeline or the motion library";
+            regressed = benchmark;
+            demoCompleted = true; // do not retry until reconnected
+            return;
+        }
 
-        speak("presentation_02");
-        motion.doExplanation2();
-        awaitSpeechAndMotionCompletion();
+        yInfo() << "Presentation start";
 
-        yarp::os::SystemClock::delaySystem(1.0);
+        presentationStart = yarp::os::SystemClock::nowSystem();
 
-        speak("composition_01");
-        motion.doExplanation1();
-        awaitSpeechCompletion();
-        yarp::os::SystemClock::delaySystem(2.0);
-        speak("composition_02");
-        awaitMotionCompletion();
-        yarp::os::SystemClock::delaySystem(1.0);
-        motion.doExplanation3();
-        awaitSpeechAndMotionCompletion();
+        const auto & cues = timeline.getCues();
 
-        speak("composition_03");
-        motion.doExplanationHead();
-        awaitSpeechAndMotionCompletion();
+        for (auto i = 0; i < cues.size(); i++)
+        {
+            const auto & cue = cues[i];
 
-        speak("composition_04");
-        motion.doExplanationRightPC();
-        awaitSpeechCompletion();
-        speak("composition_05_01");
-        awaitSpeechAndMotionCompletion();
+            switch (cue.type)
+            {
+            case Timeline::Cue::Type::Speak:
+                speak(cue.label);
 
-        speak("composition_05_02");
-        motion.doExplanationLeftPC();
-        awaitSpeechAndMotionCompletion();
+                // look ahead for the next sentence while this one plays
+                for (auto j = i + 1; j < cues.size(); j++)
+                {
+                    if (cues[j].type == Timeline::Cue::Type::Speak)
+                    {
+                        prefetch(cues[j].label);
+                        break;
+                    }
+                }
 
-        speak("composition_05_03");
-        motion.doExplanationInsidePC();
-        awaitSpeechAndMotionCompletion();
+                break;
+            case Timeline::Cue::Type::Move:
+                move(cue.label, cue.policy, cue.mark.empty() ? 0.0 : awaitMark(cue.mark));
+                break;
+            case Timeline::Cue::Type::Await:
+                if (cue.target != Timeline::Cue::Target::Motion)
+                {
+                    awaitSpeechCompletion();
+                }
 
-        speak("composition_06");
-        motion.doExplanation2();
-        awaitSpeechAndMotionCompletion();
+                if (cue.target != Timeline::Cue::Target::Speech)
+                {
+                    awaitMotionCompletion();
+                }
 
-        speak("composition_07");
-        motion.doExplanationSensors();
-        awaitSpeechAndMotionCompletion();
+                break;
+            case Timeline::Cue::Type::Pause:
+                switch (cue.target)
+                {
+                case Timeline::Cue::Target::Motion:
+                    pauseUntil(getLastMotionDone() + cue.seconds);
+                    break;
+                case Timeline::Cue::Target::Now:
+                    pauseUntil(yarp::os::SystemClock::nowSystem() + cue.seconds);
+                    break;
+                default:
+                    pauseUntil(lastSpeechDone + cue.seconds);
+                    break;
+                }
 
-        yarp::os::SystemClock::delaySystem(1.0);
+                break;
+            case Timeline::Cue::Type::Offset:
+                pauseUntil((cue.target == Timeline::Cue::Target::Motion ? lastMotionStart : lastSpeechStart) + cue.seconds);
+                break;
+            }
+        }
+    }
+    catch (const ThreadTerminator & terminator)
+    {
+        yInfo() << "Prematurely terminating presentation thread";
+        return;
+    }
 
-        speak("purpose_01");
-        motion.doExplanation1();
-        awaitSpeechAndMotionCompletion();
+    yInfo() << "Presentation end";
+    reportBenchmark(yarp::os::SystemClock::nowSystem() - presentationStart);
+    demoCompleted = true;
+}
+
+bool DialogueManager::loadLanguages(SentenceTable & table) const
+{
+    bool isLoaded = true;
 
-        yarp::os::SystemClock::delaySystem(1.0);
+    for (const auto & file : languageFiles)
+    {
+        if (!loadLanguage(file.path, table))
+        {
+            yWarning() << "Skipping language file" << file.path;
+            isLoaded = false;
+        }
+    }
 
-        speak("purpose_02");
-        motion.doExplanation4();
-        awaitSpeechAndMotionCompletion();
+    return isLoaded;
+}
 
-        yarp::os::SystemClock::delaySystem(2.0);
+bool DialogueManager::loadLanguage(const std::string & path, SentenceTable & table) const
+{
+    yarp::os::Property config;
 
-        speak("ending_01");
-        motion.doHoming();
-        awaitSpeechAndMotionCompletion();
+    if (!config.fromConfigFile(path))
+    {
+        yError() << "Unable to open language file" << path;
+        return false;
     }
-    catch (const ThreadTerminator & terminator)
+
+    auto language = table.strings.intern(std::filesystem::path(path).stem().string());
+
+    // each group is a backend, other files of the context (if any) do not have any
+    yarp::os::Bottle entries(config.toString());
+
+    for (auto i = 0; i < entries.size(); i++)
+    {
+        const auto * entry = entries.get(i).asList();
+
+        if (!entry || entry->size() < 2 || !entry->get(1).isList())
+        {
+            continue;
+        }
+
+        auto backend = entry->get(0).asString();
+        const auto & group = config.findGroup(backend);
+
+        if (!group.check("model"))
+        {
+            continue;
+        }
+
+        bool isDefault = language == defaultLanguage && backend == defaultBackend;
+        auto model = isDefault && !modelOverride.empty() ? modelOverride : group.find("model").asString();
+        auto render = isDefault && !renderOverride.empty() ? renderOverride : group.find("render").asString();
+
+        Voice voice;
+        voice.language = language;
+        voice.backend = table.strings.intern(backend);
+        voice.model = table.strings.intern(model);
+        voice.render = table.strings.intern(render);
+
+        std::string lastSentence;
+        bool isComplete = true;
+
+        for (const auto & cue : timeline.getCues())
+        {
+            if (cue.type == Timeline::Cue::Type::Speak)
+            {
+                const auto & value = group.find(cue.label);
+                auto id = table.strings.intern(cue.label);
+
+                if (!value.isString())
+                {
+                    yWarning() << "Backend" << backend << "of" << path << "does not have sentence" << cue.label;
+                    isComplete = false;
+                    break;
+                }
+
+                if (!voice.sentences[id].fromString(value.asString(), table.strings))
+                {
+                    isComplete = false;
+                    break;
+                }
+
+                lastSentence = cue.label;
+            }
+            else if (cue.type == Timeline::Cue::Type::Move && !cue.mark.empty())
+            {
+                if (lastSentence.empty() || voice.sentences.at(lastSentence).findMark(cue.mark) == -1)
+                {
+                    yWarning("Mark %s of timeline line %d not found in the last sentence (%s) of backend %s of %s",
+                             cue.mark.c_str(), cue.line, lastSentence.c_str(), backend.c_str(), path.c_str());
+                    isComplete = false;
+                    break;
+                }
+            }
+        }
+
+        if (!isComplete)
+        {
+            yWarning() << "Skipping backend" << backend << "of" << path;
+            continue;
+        }
+
+        if (!cacheDir.empty() && !render.empty())
+        {
+            voice.hasCache = voice.cache.configure(cacheDir, backend, model, render);
+        }
+
+        table.voices.push_back(std::move(voice));
+    }
+
+    return true;
+}
+
+void DialogueManager::reloadLanguages()
+{
+    bool isModified = false;
+
+    for (auto & file : languageFiles)
+    {
+        std::error_code ec;
+        auto modified = std::filesystem::last_write_time(file.path, ec);
+
+        if (!ec && modified != file.modified)
+        {
+            file.modified = modified;
+            isModified = true;
+        }
+    }
+
+    if (!isModified)
     {
-        yInfo() << "Prematurely terminating presentation thread";
         return;
     }
 
-    yInfo() << "Presentation end";
-    demoCompleted = true;
+    auto start = yarp::os::SystemClock::nowSystem();
+    auto table = std::make_shared<SentenceTable>();
+
+    if (!loadLanguages(*table))
+    {
+        yWarning() << "Keeping previous sentences, save the language file again once fixed";
+        return;
+    }
+
+    auto previous = getSentences();
+
+    // cached audio of unchanged sentences is still valid, that of edited ones is dropped
+    int changed = 0;
+
+    for (const auto & voice : previous->voices)
+    {
+        const auto * next = table->find(voice.language, voice.backend);
+
+        for (const auto & [id, sentence] : voice.sentences)
+        {
+            auto text = sentence.getText();
+            const Sentence * edited = nullptr;
+
+            if (next)
+            {
+                if (auto it = next->sentences.find(id); it != next->sentences.end())
+                {
+                    edited = &it->second;
+                }
+            }
+
+            if (edited && edited->getText() == text && next->model == voice.model)
+            {
+                continue;
+            }
+
+            changed++;
+
+            // unless another sentence still says the same
+            if (voice.hasCache && (!next || next->model != voice.model
+                || std::none_of(next->sentences.cbegin(), next->sentences.cend(), [text](const auto & entry) { return entry.second.getText() == text; })))
+            {
+                voice.cache.evict(std::string(text));
+            }
+        }
+    }
+
+    auto parsed = yarp::os::SystemClock::nowSystem();
+    std::atomic_store(&sentences, std::shared_ptr<const SentenceTable>(std::move(table)));
+    auto swapped = yarp::os::SystemClock::nowSystem();
+    languageReloaded = swapped;
+
+    yInfo("Reloaded language files: %d sentences changed, parsed in %.3f ms, swapped in %.3f us",
+          changed, (parsed - start) * 1e3, (swapped - parsed) * 1e6);
+}
+
+std::shared_ptr<const DialogueManager::SentenceTable> DialogueManager::getSentences() const
+{
+    return std::atomic_load(&sentences);
+}
+
+std::shared_ptr<const DialogueManager::Voice> DialogueManager::findVoice(const std::shared_ptr<const SentenceTable> & table,
+                                                                         std::string_view language, std::string_view backend)
+{
+    const auto * voice = table->find(language, backend);
+    return voice ? std::shared_ptr<const Voice>(table, voice) : nullptr; // shares ownership of the table
+}
+
+const DialogueManager::Voice * DialogueManager::SentenceTable::find(std::string_view language, std::string_view backend) const
+{
+    auto it = std::find_if(voices.cbegin(), voices.cend(), [language, backend](const auto & voice)
+    {
+        return voice.language == language && voice.backend == backend;
+    });
+
+    return it != voices.cend() ? &*it : nullptr;
+}
+
+bool DialogueManager::Commands::setLanguage(const std::string & language, const std::string & backend)
+{
+    auto start = yarp::os::SystemClock::nowSystem();
+    std::lock_guard lock(owner.languageMutex);
+    auto chosen = backend.empty() ? owner.selectedBackend : backend;
+
+    if (!owner.getSentences()->find(language, chosen))
+    {
+        yWarning() << "Backend" << chosen << "for language" << language << "not found or incomplete";
+        return false;
+    }
+
+    owner.selectedLanguage = language;
+    owner.selectedBackend = chosen;
+
+    yInfo("Selected language %s with backend %s in %.3f ms%s", language.c_str(), chosen.c_str(), (yarp::os::SystemClock::nowSystem() - start) * 1e3,
+          owner.yarp::os::Thread::isRunning() ? ", effective from the next presentation" : "");
+
+    return true;
+}
+
+VoiceDescription DialogueManager::Commands::getLanguage()
+{
+    std::lock_guard lock(owner.languageMutex);
+    VoiceDescription description;
+    description.language = owner.selectedLanguage;
+    description.backend = owner.selectedBackend;
+
+    if (const auto * voice = owner.getSentences()->find(owner.selectedLanguage, owner.selectedBackend))
+    {
+        description.model = voice->model;
+    }
+
+    return description;
+}
+
+std::vector<VoiceDescription> DialogueManager::Commands::getLanguages()
+{
+    auto table = owner.getSentences();
+    std::vector<VoiceDescription> descriptions;
+
+    for (const auto & voice : table->voices)
+    {
+        VoiceDescription description;
+        description.language = voice.language;
+        description.backend = voice.backend;
+        description.model = voice.model;
+        descriptions.push_back(std::move(description));
+    }
+
+    return descriptions;
 }
 
 void DialogueManager::speak(const std::string & sentenceId)
 {
-    yInfo() << sentenceId << "->" << sentences[sentenceId];
+    auto table = getSentences();
+
+    if (table != spokenTable)
+    {
+        if (spokenTable)
+        {
+            yInfo("Reloaded sentences in use %.3f s after the swap", yarp::os::SystemClock::nowSystem() - languageReloaded);
+        }
+
+        spokenTable = table;
+    }
+
+    auto voice = findVoice(table, runLanguage, runBackend);
+
+    if (!voice)
+    {
+        yWarning() << "Backend" << runBackend << "for language" << runLanguage << "is no longer available, skipping" << sentenceId;
+        return;
+    }
+
+    // shares ownership of the table, which may be replaced meanwhile
+    auto sentencePtr = std::shared_ptr<const Sentence>(voice, &voice->sentences.at(sentenceId));
+    const auto & sentence = *sentencePtr;
+    const std::string text(sentence.getText());
+    yInfo() << sentenceId << "->" << text;
 
-    if (!tts.say(sentences[sentenceId]))
+    speakIssued = yarp::os::SystemClock::nowSystem();
+    sayCalls++;
+
+    if (lastSpeechDone != 0.0)
+    {
+        latencies.record(sentenceId, "gap_before", speakIssued - lastSpeechDone);
+        totalSpeechGap += speakIssued - lastSpeechDone;
+    }
+
+    yarp::sig::Sound sound;
+    bool hasSound = false;
+
+    if (useCache && voice->hasCache && audioPort.getOutputCount() > 0)
+    {
+        if (prefetched.valid())
+        {
+            auto utterance = prefetched.get();
+
+            if (utterance.loaded && utterance.text == text)
+            {
+                sound = std::move(utterance.sound);
+                hasSound = true;
+            }
+        }
+
+        hasSound = hasSound || voice->cache.load(text, sound);
+    }
+
+    spokenSentence = nullptr;
+    wordOffsets.clear();
+
+    if (hasSound)
+    {
+        auto duration = sound.getSamples() / static_cast<double>(sound.getFrequency());
+        audioPort.prepare() = sound;
+        audioPort.writeStrict();
+        utteranceStart = yarp::os::SystemClock::nowSystem();
+        playbackEnd = utteranceStart + duration;
+        cachedPlays++;
+
+        if (sentence.hasMarks())
+        {
+            wordOffsets = sentence.estimateWordOffsets(duration);
+        }
+    }
+    else if (!tts.say(text))
     {
         yWarning() << "Unable to say" << sentenceId;
+        return;
+    }
+
+    sayReturned = lastSpeechStart = yarp::os::SystemClock::nowSystem();
+    latencies.record(sentenceId, "say_call", sayReturned - speakIssued);
+    pendingSentence = sentenceId;
+    spokenSentence = sentencePtr;
+
+    if (!hasSound && sentence.hasMarks() && timingPort.getOutputCount() > 0)
+    {
+        utteranceStart = sayReturned;
+        wordOffsets = timing.getWordOffsets();
+
+        if (wordOffsets.size() != sentence.getNumWords())
+        {
+            yWarning("Got timing of %zu words for %s, expected %zu", wordOffsets.size(), sentenceId.c_str(), sentence.getNumWords());
+            wordOffsets.clear();
+        }
     }
 }
 
-void DialogueManager::awaitSpeechCompletion()
+void DialogueManager::prefetch(const std::string & sentenceId)
 {
-    do
+    auto voice = useCache ? findVoice(getSentences(), runLanguage, runBackend) : nullptr;
+
+    if (!voice || !voice->hasCache)
+    {
+        return;
+    }
+
+    prefetched = std::async(std::launch::async, [voice, text = std::string(voice->sentences.at(sentenceId).getText())]
+    {
+        Utterance utterance;
+        utterance.text = text;
+        utterance.loaded = voice->cache.load(text, utterance.sound);
+        return utterance;
+    });
+}
+
+void DialogueManager::pauseUntil(double until)
+{
+    // overlap-aware: only wait for the remainder of the gap, if any
+    for (auto now = yarp::os::SystemClock::nowSystem(); now < until; now = yarp::os::SystemClock::nowSystem())
     {
         if (yarp::os::Thread::isStopping())
         {
             throw ThreadTerminator();
         }
 
-        yarp::os::SystemClock::delaySystem(0.1);
+        yarp::os::SystemClock::delaySystem(std::min(0.1, until - now));
+    }
+}
+
+double DialogueManager::getLastMotionDone()
+{
+    std::lock_guard lock(motionStateMutex);
+    return lastMotionDone;
+}
+
+void DialogueManager::onStop()
+{
+    motionStateCond.notify_all();
+}
+
+void DialogueManager::onRead(yarp::os::Bottle & event)
+{
+    // (event action id waypoint timestamp)
+    auto type = event.get(0).asString();
+
+    yDebug() << "Motion event:" << event.toString();
+
+    {
+        std::lock_guard lock(motionStateMutex);
+        lastMotionEvent = yarp::os::SystemClock::nowSystem();
+    }
+
+    if (type == "moving")
+    {
+        std::lock_guard lock(motionStateMutex);
+
+        if (markedMotionId != 0 && event.get(2).asInt32() == markedMotionId)
+        {
+            auto drift = yarp::os::SystemClock::nowSystem() - markedMotionTime;
+            yInfo("Motion %s started %.3f s after its mark", markedMotion.c_str(), drift);
+            latencies.record(markedMotion, "mark_to_motion", drift);
+            markedMotionId = 0;
+        }
+    }
+    else if (type == "done" || type == "aborted")
+    {
+        std::lock_guard lock(motionStateMutex);
+
+        auto id = event.get(2).asInt32();
+
+        if (id == markedMotionId)
+        {
+            markedMotionId = 0; // never started moving
+        }
+
+        // ignore actions of other clients and late events of a previous run
+        if (pendingMotions.erase(id) != 0)
+        {
+            lastMotionDone = yarp::os::SystemClock::nowSystem();
+            motionStateCond.notify_all();
+        }
+    }
+}
+
+double DialogueManager::awaitMark(const std::string & mark)
+{
+    auto word = spokenSentence ? spokenSentence->findMark(mark) : -1;
+
+    if (word == -1 || wordOffsets.empty())
+    {
+        yWarning() << "No timing for mark" << mark << "of the last sentence, moving right away";
+        return yarp::os::SystemClock::nowSystem();
+    }
+
+    auto markTime = utteranceStart + wordOffsets[word];
+    pauseUntil(markTime - motionLead);
+    return markTime;
+}
+
+void DialogueManager::move(const std::string & action, ActionPolicy policy, double markTime)
+{
+    // held across the request so that its events are not handled before the id is known
+    std::lock_guard lock(motionStateMutex);
+
+    if (lastMotionDone != 0.0 && pendingMotions.empty())
+    {
+        // robot was idle since the previous motion finished
+        auto idle = yarp::os::SystemClock::nowSystem() - lastMotionDone;
+        latencies.record("motion_" + std::to_string(motionsRequested + 1), "idle_before", idle);
+        totalMotionIdle += idle;
+    }
+
+    motionsRequested++;
+
+    auto id = motion.doAction(action, policy);
+    lastMotionStart = yarp::os::SystemClock::nowSystem();
+
+    if (id == 0)
+    {
+        yWarning() << "Motion" << action << "was rejected";
+        lastMotionDone = yarp::os::SystemClock::nowSystem(); // rejected requests are not reported as aborted
+        return;
+    }
+
+    pendingMotions.insert(id);
+
+    if (markTime != 0.0)
+    {
+        latencies.record(action, "mark_to_command", yarp::os::SystemClock::nowSystem() - markTime);
+        markedMotionId = id;
+        markedMotionTime = markTime;
+        markedMotion = action;
+    }
+}
+
+void DialogueManager::awaitSpeechCompletion()
+{
+    if (playbackEnd != 0.0)
+    {
+        // audio sink does not report its status, rely on the known length of the utterance instead
+        for (auto now = yarp::os::SystemClock::nowSystem(); now < playbackEnd; now = yarp::os::SystemClock::nowSystem())
+        {
+            if (yarp::os::Thread::isStopping())
+            {
+                throw ThreadTerminator();
+            }
+
+            yarp::os::SystemClock::delaySystem(std::min(0.1, playbackEnd - now));
+        }
+
+        playbackEnd = 0.0;
+    }
+    else
+    {
+        do
+        {
+            if (yarp::os::Thread::isStopping())
+            {
+                throw ThreadTerminator();
+            }
+
+            yarp::os::SystemClock::delaySystem(0.1);
+            checkSayDoneCalls++;
+        }
+        while (speechPort.getOutputCount() > 0 && !tts.checkSayDone());
+    }
+
+    if (!pendingSentence.empty())
+    {
+        auto now = yarp::os::SystemClock::nowSystem();
+        lastSpeechDone = now;
+        latencies.record(pendingSentence, "say_to_done", now - sayReturned);
+        latencies.record(pendingSentence, "speak_to_done", now - speakIssued);
+        pendingSentence.clear();
     }
-    while (speechPort.getOutputCount() > 0 && !tts.checkSayDone());
 }
 
 void DialogueManager::awaitMotionCompletion()
 {
+    if (motionStatePort.getInputCount() > 0)
+    {
+        std::unique_lock lock(motionStateMutex);
+        auto lastPoll = yarp::os::SystemClock::nowSystem();
+
+        while (motionPort.getOutputCount() > 0 && !pendingMotions.empty())
+        {
+            if (yarp::os::Thread::isStopping())
+            {
+                throw ThreadTerminator();
+            }
+
+            motionStateCond.wait_for(lock, std::chrono::milliseconds(100));
+
+            // events are best-effort (dropped if bodyExecution lags, lost on reconnection)
+            if (auto now = yarp::os::SystemClock::nowSystem(); now - std::max(lastPoll, lastMotionEvent) >= MOTION_EVENT_TIMEOUT && !pendingMotions.empty())
+            {
+                std::vector<int> ids(pendingMotions.cbegin(), pendingMotions.cend());
+                lock.unlock();
+
+                std::vector<int> done;
+
+                for (auto id : ids)
+                {
+                    checkMotionDoneCalls++;
+
+                    if (motion.checkActionDone(id))
+                    {
+                        done.push_back(id);
+                    }
+                }
+
+                lock.lock();
+                lastPoll = yarp::os::SystemClock::nowSystem();
+
+                for (auto id : done)
+                {
+                    if (pendingMotions.erase(id) != 0)
+                    {
+                        yWarning() << "No completion event for motion" << id << "- polled instead";
+                        lastMotionDone = lastPoll;
+                    }
+                }
+            }
+        }
+
+        return;
+    }
+
+    // no event stream, poll instead
     do
     {
         if (yarp::os::Thread::isStopping())
@@ -313,12 +1068,200 @@ void DialogueManager::awaitMotionCompletion()
         }
 
         yarp::os::SystemClock::delaySystem(0.1);
+        checkMotionDoneCalls++;
     }
     while (motionPort.getOutputCount() > 0 && !motion.checkMotionDone());
+
+    std::lock_guard lock(motionStateMutex);
+    pendingMotions.clear(); // resync in case the event stream is connected later
+    lastMotionDone = yarp::os::SystemClock::nowSystem();
+}
+
+void DialogueManager::awaitMotionReady()
+{
+    // bodyExecution answers right away, but rejects actions until connected to the robot
+    while (motionPort.getOutputCount() > 0)
+    {
+        auto state = motion.getStartupState();
+
+        if (state == "ready")
+        {
+            return;
+        }
+
+        if (state == "failed")
+        {
+            yWarning() << "Motion server failed to start, presenting without motion";
+            return;
+        }
+
+        yDebugThrottle(1.0) << "Waiting for motion server to warm up";
+
+        if (yarp::os::Thread::isStopping())
+        {
+            throw ThreadTerminator();
+        }
+
+        yarp::os::SystemClock::delaySystem(0.1);
+    }
+}
+
+bool DialogueManager::checkTimelineActions()
+{
+    // the motion library lives in bodyExecution, hence this is checked once it is ready
+    if (motionPort.getOutputCount() == 0)
+    {
+        return true;
+    }
+
+    std::unordered_set<std::string> known;
+
+    for (const auto & estimate : motion.estimateDurations())
+    {
+        known.insert(estimate.action);
+    }
+
+    if (known.empty())
+    {
+        yWarning() << "Unable to list the actions of the motion server";
+        return true;
+    }
+
+    bool ok = true;
+
+    for (const auto & cue : timeline.getCues())
+    {
+        if (cue.type == Timeline::Cue::Type::Move && known.find(cue.label) == known.cend())
+        {
+            yError() << "Unknown action" << cue.label << "at line" << cue.line << "of the timeline";
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+void DialogueManager::reportBenchmark(double totalTime)
+{
+    int motionCommands;
+
+    {
+        std::lock_guard lock(motionStateMutex);
+        motionCommands = motionsRequested;
+    }
+
+    const std::vector<std::pair<std::string, double>> results {
+        {"total_time", totalTime},
+        {"speech_gap_time", totalSpeechGap},
+        {"motion_idle_time", totalMotionIdle},
+        {"say_calls", sayCalls},
+        {"check_say_done_calls", checkSayDoneCalls},
+        {"check_motion_done_calls", checkMotionDoneCalls},
+        {"motion_commands", motionCommands},
+    };
+
+    latencies.record("presentation", "total", totalTime);
+
+    for (const auto & [key, value] : results)
+    {
+        yInfo() << "Benchmark:" << key << value;
+    }
+
+    if (useCache)
+    {
+        yInfo() << "Benchmark:" << cachedPlays << "of" << sayCalls << "sentences played from the speech cache";
+    }
+
+    if (!benchmark)
+    {
+        return;
+    }
+
+    // same format as the baseline, so that it can be used as such
+    std::ofstream out(resultsPath);
+
+    for (const auto & [key, value] : results)
+    {
+        out << key << " " << value << "\n";
+    }
+
+    if (!out)
+    {
+        yWarning() << "Unable to write benchmark results to" << resultsPath;
+    }
+
+    if (baselinePath.empty())
+    {
+        return;
+    }
+
+    yarp::os::Property baseline;
+
+    if (!baseline.fromConfigFile(baselinePath))
+    {
+        yError() << "Unable to read benchmark baseline from" << baselinePath;
+        regressed = true;
+        return;
+    }
+
+    for (const auto & [key, value] : results)
+    {
+        if (baseline.check(key) && value > baseline.find(key).asFloat64() * (1.0 + tolerance))
+        {
+            yError() << "Regression on" << key << "- got" << value << "but baseline is" << baseline.find(key).asFloat64();
+            regressed = true;
+        }
+    }
+
+    if (!regressed)
+    {
+        yInfo() << "No regressions against baseline" << baselinePath;
+    }
 }
 
-void DialogueManager::awaitSpeechAndMotionCompletion()
+void DialogueManager::renderSentences()
 {
-    awaitSpeechCompletion();
-    awaitMotionCompletion();
+    std::shared_ptr<const Voice> renderedVoice;
+
+    while (!renderStop)
+    {
+        std::string language;
+        std::string backend;
+
+        {
+            std::lock_guard lock(languageMutex);
+            language = selectedLanguage;
+            backend = selectedBackend;
+        }
+
+        auto voice = findVoice(getSentences(), language, backend);
+
+        if (!voice || voice == renderedVoice || !voice->hasCache)
+        {
+            yarp::os::SystemClock::delaySystem(0.1); // a reload or a switch only renders what is missing
+            continue;
+        }
+
+        auto start = yarp::os::SystemClock::nowSystem();
+        int rendered = 0;
+
+        // in order of appearance, so that the first sentences are ready first
+        for (const auto & cue : timeline.getCues())
+        {
+            if (renderStop)
+            {
+                return;
+            }
+
+            if (cue.type == Timeline::Cue::Type::Speak && voice->cache.render(std::string(voice->sentences.at(cue.label).getText())))
+            {
+                rendered++;
+            }
+        }
+
+        yInfo("Speech cache ready for %s (%s): %d/%zu sentences in %.3f s", language.c_str(), backend.c_str(), rendered, voice->sentences.size(),
+              yarp::os::SystemClock::nowSystem() - start);
+
+        renderedVoice = voice;
+    }
 }
@@ -4,16 +4,38 @@
 #define __DIALOGUE_MANAGER_HPP__
 
 #include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include <yarp/os/Bottle.h>
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/RFModule.h>
 #include <yarp/os/RpcClient.h>
 #include <yarp/os/Thread.h>
+#include <yarp/os/TypedReaderCallback.h>
+
+#include <yarp/sig/Sound.h>
 
 #include <SpeechSynthesis.h>
 
+#include "DialogueManagerCommands.h"
 #include "SelfPresentationCommands.h"
+#include "SpeechTiming.h"
+
+#include "LatencyStatistics.hpp"
+#include "Sentence.hpp"
+#include "SpeechCache.hpp"
+#include "StringPool.hpp"
+#include "Timeline.hpp"
 
 namespace roboticslab
 {
@@ -21,9 +43,13 @@ namespace roboticslab
 /**
  * @ingroup teo-self-presentation_programs
  * @brief Dialogue Manager.
+ *
+ * Every backend of every configured language file is loaded at startup, hence the language and
+ * backend can be switched between presentations through the RPC port.
  */
 class DialogueManager : public yarp::os::RFModule,
-                        public yarp::os::Thread
+                        public yarp::os::Thread,
+                        public yarp::os::TypedReaderCallback<yarp::os::Bottle>
 {
 public:
     ~DialogueManager()
@@ -35,24 +61,168 @@ public:
     double getPeriod() override;
     bool updateModule() override;
 
+    bool hasRegressed() const
+    { return regressed; }
+
     bool threadInit() override;
     void threadRelease() override;
     void run() override;
+    void onStop() override;
+
+    void onRead(yarp::os::Bottle & event) override;
 
 private:
+    //! Sentences of a language as said by a TTS backend, strings point into the owning table.
+    struct Voice
+    {
+        std::string_view language;
+        std::string_view backend;
+        std::string_view model;
+        std::string_view render;
+        std::unordered_map<std::string_view, Sentence> sentences; // by id, as in the timeline
+        SpeechCache cache;
+        bool hasCache {false};
+    };
+
+    //! Immutable once published, replaced as a whole when a language file changes.
+    struct SentenceTable
+    {
+        StringPool strings;
+        std::vector<Voice> voices;
+
+        const Voice * find(std::string_view language, std::string_view backend) const;
+    };
+
+    class Commands : public DialogueManagerCommands
+    {
+    public:
+        explicit Commands(DialogueManager & _owner) : owner(_owner) {}
+        bool setLanguage(const std::string & language, const std::string & backend) override;
+        VoiceDescription getLanguage() override;
+        std::vector<VoiceDescription> getLanguages() override;
+
+    private:
+        DialogueManager & owner;
+    };
+
+    struct LanguageFile
+    {
+        std::string path;
+        std::filesystem::file_time_type modified;
+    };
+
+    //! Load every parsable language file, false if any had to be skipped.
+    bool loadLanguages(SentenceTable & table) const;
+    bool loadLanguage(const std::string & path, SentenceTable & table) const;
+    void reloadLanguages();
+    std::shared_ptr<const SentenceTable> getSentences() const;
+    static std::shared_ptr<const Voice> findVoice(const std::shared_ptr<const SentenceTable> & table, std::string_view language, std::string_view backend);
     void speak(const std::string & sentenceId);
+    void move(const std::string & action, ActionPolicy policy, double markTime = 0.0);
+    double awaitMark(const std::string & mark);
     void awaitSpeechCompletion();
     void awaitMotionCompletion();
-    void awaitSpeechAndMotionCompletion();
+    void awaitMotionReady();
+    bool checkTimelineActions();
+    void pauseUntil(double until);
+    void prefetch(const std::string & sentenceId);
+    double getLastMotionDone();
+    void reportBenchmark(double totalTime);
+    void renderSentences();
 
     SpeechSynthesis tts;
+    SpeechTiming timing;
     SelfPresentationCommands motion;
 
     yarp::os::RpcClient speechPort;
+    yarp::os::RpcClient timingPort;
     yarp::os::RpcClient motionPort;
-
-    std::string model;
-    std::unordered_map<std::string, std::string> sentences;
+    yarp::os::BufferedPort<yarp::os::Bottle> motionStatePort;
+    yarp::os::BufferedPort<yarp::sig::Sound> audioPort;
+    yarp::os::RpcClient audioControlPort; // RPC port of the audio player
+
+    // motion lifecycle events pushed by bodyExecution
+    std::mutex motionStateMutex;
+    std::condition_variable motionStateCond;
+    int motionsRequested {0};
+    std::unordered_set<int> pendingMotions; // ids returned by doAction, until done or aborted
+    double lastMotionEvent {0.0};
+
+    Timeline timeline;
+
+    // published by the module thread, read through getSentences() (std::atomic_load)
+    std::shared_ptr<const SentenceTable> sentences;
+    std::shared_ptr<const SentenceTable> spokenTable; // presentation thread only
+    std::vector<LanguageFile> languageFiles;
+    std::atomic<double> languageReloaded {0.0};
+
+    // command line choices, the model and render command may be overridden for those
+    std::string defaultLanguage;
+    std::string defaultBackend;
+    std::string modelOverride;
+    std::string renderOverride;
+    std::string cacheDir;
+
+    // selected through RPC, applied when a presentation starts
+    Commands commands {*this};
+    yarp::os::RpcServer commandPort;
+    std::mutex languageMutex;
+    std::string selectedLanguage;
+    std::string selectedBackend;
+    std::string runLanguage; // presentation thread only
+    std::string runBackend;
+
+    // word timing of the last sentence, for motions anchored to its marks
+    std::shared_ptr<const Sentence> spokenSentence;
+    double utteranceStart {0.0};
+    std::vector<double> wordOffsets; // [s] since utteranceStart, empty if unknown
+    double motionLead {0.0};
+
+    // drift of the last anchored motion, measured once it starts moving (guarded by motionStateMutex)
+    int markedMotionId {0};
+    double markedMotionTime {0.0};
+    std::string markedMotion;
+
+    // pre-synthesized utterances (see Voice::cache), played through audioPort instead of the TTS server
+    bool useCache {false};
+    std::thread renderThread;
+    std::atomic<bool> renderStop {false};
+    double playbackEnd {0.0};
+
+    struct Utterance
+    {
+        std::string text;
+        yarp::sig::Sound sound;
+        bool loaded {false};
+    };
+
+    // next sentence, loaded while the current one plays
+    std::future<Utterance> prefetched;
+    int cachedPlays {0};
+
+    std::string statsPath;
+    int runCount {0};
+    std::string pendingSentence;
+    double speakIssued {0.0};
+    double sayReturned {0.0};
+    LatencyStatistics latencies {"dialogueManager", 0.1, 300}; // [s], up to 30 s
+
+    bool benchmark {false};
+    std::string baselinePath;
+    std::string resultsPath;
+    double tolerance {0.0};
+    std::atomic<bool> regressed {false};
+
+    double presentationStart {0.0};
+    double lastSpeechStart {0.0};
+    double lastSpeechDone {0.0};
+    double lastMotionStart {0.0};
+    double lastMotionDone {0.0}; // guarded by motionStateMutex
+    double totalSpeechGap {0.0};
+    double totalMotionIdle {0.0};
+    int sayCalls {0};
+    int checkSayDoneCalls {0};
+    int checkMotionDoneCalls {0};
 
     std::atomic<bool> demoCompleted {false};
 };
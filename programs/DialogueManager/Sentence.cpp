@@ -0,0 +1,100 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "Sentence.hpp"
+
+#include <cctype> // std::isspace
+
+#include <algorithm> // std::find_if
+
+#include <yarp/os/LogStream.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    bool isSpace(char c)
+    {
+        return std::isspace(static_cast<unsigned char>(c));
+    }
+}
+
+bool Sentence::fromString(const std::string & raw, StringPool & pool)
+{
+    std::string spoken;
+    wordStarts.clear();
+    marks.clear();
+
+    for (std::size_t i = 0; i < raw.size(); i++)
+    {
+        if (raw[i] == '{')
+        {
+            auto end = raw.find('}', i);
+
+            if (end == std::string::npos || end == i + 1)
+            {
+                yError() << "Unterminated or empty mark in sentence:" << raw;
+                return false;
+            }
+
+            auto name = raw.substr(i + 1, end - i - 1);
+
+            if (findMark(name) != -1)
+            {
+                yError() << "Duplicate mark" << name << "in sentence:" << raw;
+                return false;
+            }
+
+            // the next word, unless in the middle of one
+            bool isMidWord = !spoken.empty() && !isSpace(spoken.back());
+            marks.emplace_back(pool.intern(name), wordStarts.size() - (isMidWord ? 1 : 0));
+
+            i = end;
+
+            // avoid doubling the whitespace around the mark
+            while ((spoken.empty() || isSpace(spoken.back())) && i + 1 < raw.size() && isSpace(raw[i + 1]))
+            {
+                i++;
+            }
+        }
+        else
+        {
+            if (!isSpace(raw[i]) && (spoken.empty() || isSpace(spoken.back())))
+            {
+                wordStarts.push_back(spoken.size());
+            }
+
+            spoken += raw[i];
+        }
+    }
+
+    for (const auto & [name, word] : marks)
+    {
+        if (word >= static_cast<int>(wordStarts.size()))
+        {
+            yError() << "Mark" << std::string(name) << "does not precede any word in sentence:" << raw;
+            return false;
+        }
+    }
+
+    text = pool.intern(spoken);
+    return true;
+}
+
+int Sentence::findMark(std::string_view name) const
+{
+    auto it = std::find_if(marks.cbegin(), marks.cend(), [&name](const auto & mark) { return mark.first == name; });
+    return it != marks.cend() ? it->second : -1;
+}
+
+std::vector<double> Sentence::estimateWordOffsets(double duration) const
+{
+    std::vector<double> offsets;
+    offsets.reserve(wordStarts.size());
+
+    for (auto start : wordStarts)
+    {
+        offsets.push_back(text.empty() ? 0.0 : duration * start / text.size());
+    }
+
+    return offsets;
+}
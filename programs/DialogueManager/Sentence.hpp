@@ -0,0 +1,55 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __SENTENCE_HPP__
+#define __SENTENCE_HPP__
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "StringPool.hpp"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Sentence of the language file along with the named marks that anchor motions to its words.
+ *
+ * A mark is written as `{name}` right before the word it anchors, e.g. "the computer on my {right}
+ * right". Marks are stripped from the text sent to the TTS server or the speech cache. Words are
+ * separated by whitespace, as with the TTS timing service. The text and the names of the marks
+ * are interned in a pool, which must outlive the sentence.
+ */
+class Sentence
+{
+public:
+    bool fromString(const std::string & raw, StringPool & pool);
+
+    std::string_view getText() const
+    { return text; }
+
+    std::size_t getNumWords() const
+    { return wordStarts.size(); }
+
+    bool hasMarks() const
+    { return !marks.empty(); }
+
+    //! Index of the word anchored by the mark, -1 if not found.
+    int findMark(std::string_view name) const;
+
+    //! Start of each word [s] assuming a constant rate of characters, for when the TTS cannot tell.
+    std::vector<double> estimateWordOffsets(double duration) const;
+
+private:
+    std::string_view text;
+    std::vector<std::size_t> wordStarts;
+    std::vector<std::pair<std::string_view, int>> marks;
+};
+
+} // namespace roboticslab
+
+#endif // __SENTENCE_HPP__
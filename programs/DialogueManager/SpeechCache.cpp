@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "SpeechCache.hpp"
+
+#include <cstdint>
+#include <cstdio> // std::remove, std::rename, std::snprintf
+#include <cstdlib> // std::system
+
+#include <fstream>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Os.h>
+
+#include <yarp/sig/SoundFile.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    // 64-bit FNV-1a
+    std::uint64_t hash(const std::string & data, std::uint64_t h = 14695981039346656037ULL)
+    {
+        for (unsigned char c : data)
+        {
+            h = (h ^ c) * 1099511628211ULL;
+        }
+
+        return h;
+    }
+
+    void replaceAll(std::string & str, const std::string & from, const std::string & to)
+    {
+        for (auto pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.size()))
+        {
+            str.replace(pos, from.size(), to);
+        }
+    }
+
+    // single quotes keep everything literal, but themselves
+    std::string shellQuote(const std::string & str)
+    {
+        auto quoted = str;
+        replaceAll(quoted, "'", "'\\''");
+        return "'" + quoted + "'";
+    }
+}
+
+bool SpeechCache::configure(const std::string & _directory, const std::string & _backend, const std::string & _model,
+                            const std::string & _renderCommand)
+{
+    directory = _directory;
+    backend = _backend;
+    model = _model;
+    renderCommand = _renderCommand;
+
+    if (renderCommand.empty())
+    {
+        yError() << "No render command for backend" << backend;
+        return false;
+    }
+
+    if (yarp::os::mkdir_p(directory.c_str(), 0) != 0)
+    {
+        yError() << "Unable to create speech cache directory" << directory;
+        return false;
+    }
+
+    return true;
+}
+
+std::string SpeechCache::getPath(const std::string & text) const
+{
+    // separators avoid ambiguous concatenations
+    auto key = hash(text, hash(model + '\0', hash(backend + '\0')));
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return directory + "/" + name + ".wav";
+}
+
+bool SpeechCache::render(const std::string & text) const
+{
+    auto path = getPath(text);
+
+    if (std::ifstream(path).good())
+    {
+        return true;
+    }
+
+    auto input = path + ".txt";
+    auto output = path + ".tmp.wav"; // not visible until complete
+
+    if (!(std::ofstream(input) << text))
+    {
+        yError() << "Unable to write" << input;
+        return false;
+    }
+
+    auto command = renderCommand;
+    replaceAll(command, "{model}", shellQuote(model));
+    replaceAll(command, "{input}", shellQuote(input));
+    replaceAll(command, "{output}", shellQuote(output));
+
+    int ret = std::system(command.c_str());
+    std::remove(input.c_str());
+
+    if (ret != 0 || std::rename(output.c_str(), path.c_str()) != 0)
+    {
+        yError() << "Render command failed:" << command;
+        std::remove(output.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool SpeechCache::load(const std::string & text, yarp::sig::Sound & sound) const
+{
+    auto path = getPath(text);
+    return std::ifstream(path).good() && yarp::sig::file::read(sound, path.c_str());
+}
+
+void SpeechCache::evict(const std::string & text) const
+{
+    std::remove(getPath(text).c_str());
+}
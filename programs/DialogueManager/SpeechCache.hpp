@@ -0,0 +1,48 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __SPEECH_CACHE_HPP__
+#define __SPEECH_CACHE_HPP__
+
+#include <string>
+
+#include <yarp/sig/Sound.h>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief On-disk, content-addressed cache of synthesized utterances.
+ *
+ * Each entry is a WAV file named after a hash of the backend, the voice model and the text, hence
+ * a change in any of those simply yields a new entry. Audio is rendered by an external command
+ * with the following placeholders: {model}, {input} (text file) and {output} (WAV file). The
+ * command is run by the shell, hence placeholders are substituted with single-quoted values and
+ * must not be quoted again.
+ */
+class SpeechCache
+{
+public:
+    bool configure(const std::string & directory, const std::string & backend, const std::string & model,
+                   const std::string & renderCommand);
+
+    std::string getPath(const std::string & text) const;
+
+    //! Synthesize the text unless already cached (blocking).
+    bool render(const std::string & text) const;
+
+    bool load(const std::string & text, yarp::sig::Sound & sound) const;
+
+    //! Remove the entry of a text that is no longer used, if any.
+    void evict(const std::string & text) const;
+
+private:
+    std::string directory;
+    std::string backend;
+    std::string model;
+    std::string renderCommand;
+};
+
+} // namespace roboticslab
+
+#endif // __SPEECH_CACHE_HPP__
@@ -0,0 +1,44 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "StringPool.hpp"
+
+#include <cstring> // std::memcpy
+
+using namespace roboticslab;
+
+std::string_view StringPool::intern(std::string_view str)
+{
+    if (auto it = index.find(str); it != index.end())
+    {
+        return *it;
+    }
+
+    char * data;
+
+    if (str.size() > BLOCK_SIZE / 4)
+    {
+        // on its own, so that the current block is not wasted
+        blocks.push_back(std::make_unique<char[]>(str.size()));
+        data = blocks.back().get();
+    }
+    else
+    {
+        if (!block || blockUsed + str.size() > BLOCK_SIZE)
+        {
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            block = blocks.back().get();
+            blockUsed = 0;
+        }
+
+        data = block + blockUsed;
+        blockUsed += str.size();
+    }
+
+    if (!str.empty())
+    {
+        std::memcpy(data, str.data(), str.size());
+    }
+
+    bytes += str.size();
+    return *index.emplace(data, str.size()).first;
+}
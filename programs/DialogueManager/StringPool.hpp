@@ -0,0 +1,46 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __STRING_POOL_HPP__
+#define __STRING_POOL_HPP__
+
+#include <cstddef>
+
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Append-only storage of unique strings.
+ *
+ * Each distinct string is copied once into large contiguous blocks and handed out as a view, which
+ * remains valid for the lifetime of the pool (also if moved). Equal strings share storage.
+ */
+class StringPool
+{
+public:
+    std::string_view intern(std::string_view str);
+
+    std::size_t getNumStrings() const
+    { return index.size(); }
+
+    std::size_t getBytes() const
+    { return bytes; }
+
+private:
+    static constexpr std::size_t BLOCK_SIZE = 16384;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char * block {nullptr}; // being filled
+    std::size_t blockUsed {0};
+    std::size_t bytes {0};
+    std::unordered_set<std::string_view> index;
+};
+
+} // namespace roboticslab
+
+#endif // __STRING_POOL_HPP__
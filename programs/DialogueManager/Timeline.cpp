@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "Timeline.hpp"
+
+#include <fstream>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+
+using namespace roboticslab;
+
+namespace
+{
+    bool parseTarget(const std::string & str, bool allowBoth, bool allowNow, Timeline::Cue::Target & target)
+    {
+        if (str == "speech")
+        {
+            target = Timeline::Cue::Target::Speech;
+        }
+        else if (str == "motion")
+        {
+            target = Timeline::Cue::Target::Motion;
+        }
+        else if (str == "both" && allowBoth)
+        {
+            target = Timeline::Cue::Target::Both;
+        }
+        else if (str == "now" && allowNow)
+        {
+            target = Timeline::Cue::Target::Now;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool parsePolicy(const std::string & str, ActionPolicy & policy)
+    {
+        if (str == "replace")
+        {
+            policy = POLICY_REPLACE;
+        }
+        else if (str == "enqueue")
+        {
+            policy = POLICY_ENQUEUE;
+        }
+        else if (str == "blend")
+        {
+            policy = POLICY_BLEND;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool Timeline::fromFile(const std::string & path)
+{
+    cues.clear();
+
+    std::ifstream in(path);
+
+    if (!in)
+    {
+        yError() << "Unable to open timeline" << path;
+        return false;
+    }
+
+    std::string text;
+    int line = 0;
+
+    while (std::getline(in, text))
+    {
+        line++;
+
+        auto start = text.find_first_not_of(" \t\r");
+
+        if (start == std::string::npos || text.compare(start, 2, "//") == 0)
+        {
+            continue;
+        }
+
+        yarp::os::Bottle b(text);
+        auto command = b.get(0).asString();
+        Cue cue;
+        cue.line = line;
+        bool ok = false;
+
+        if (command == "speak" && b.size() == 2)
+        {
+            cue.type = Cue::Type::Speak;
+            cue.label = b.get(1).asString();
+            ok = !cue.label.empty();
+        }
+        else if (command == "move" && b.size() >= 2 && b.size() <= 5)
+        {
+            cue.type = Cue::Type::Move;
+            cue.label = b.get(1).asString();
+
+            // optional policy, then optional mark
+            auto markAt = b.size() - 2;
+            bool hasMark = b.size() >= 4 && b.get(markAt).asString() == "at";
+
+            if (hasMark)
+            {
+                cue.mark = b.get(markAt + 1).asString();
+            }
+            else
+            {
+                markAt = b.size();
+            }
+
+            ok = !cue.label.empty() && (!hasMark || !cue.mark.empty())
+                 && (markAt == 2 || (markAt == 3 && parsePolicy(b.get(2).asString(), cue.policy)));
+        }
+        else if (command == "await" && b.size() == 2)
+        {
+            cue.type = Cue::Type::Await;
+            ok = parseTarget(b.get(1).asString(), true, false, cue.target);
+        }
+        else if (command == "pause" && (b.size() == 2 || b.size() == 3))
+        {
+            cue.type = Cue::Type::Pause;
+            cue.seconds = b.get(1).asFloat64();
+            ok = (b.get(1).isFloat64() || b.get(1).isInt32()) && cue.seconds >= 0.0
+                 && (b.size() == 2 || parseTarget(b.get(2).asString(), false, true, cue.target));
+        }
+        else if (command == "offset" && (b.size() == 2 || b.size() == 3))
+        {
+            cue.type = Cue::Type::Offset;
+            cue.seconds = b.get(1).asFloat64() * 0.001;
+            ok = (b.get(1).isFloat64() || b.get(1).isInt32()) && cue.seconds >= 0.0
+                 && (b.size() == 2 || parseTarget(b.get(2).asString(), false, false, cue.target));
+        }
+
+        if (!ok)
+        {
+            yError("Illegal cue at %s:%d: %s", path.c_str(), line, text.c_str());
+            return false;
+        }
+
+        cues.push_back(cue);
+    }
+
+    if (cues.empty())
+    {
+        yError() << "Timeline" << path << "does not have any cues";
+        return false;
+    }
+
+    return true;
+}
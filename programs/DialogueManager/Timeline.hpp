@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __TIMELINE_HPP__
+#define __TIMELINE_HPP__
+
+#include <string>
+#include <vector>
+
+#include "ActionPolicy.h"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Ordered list of presentation cues parsed from a text file.
+ *
+ * One cue per line, empty lines and lines starting with // are ignored:
+ *
+ * - `speak <sentence>`: start saying a sentence of the language file, does not block.
+ * - `move <action> [replace|enqueue|blend] [at <mark>]`: start a motion (default: replace the
+ *   current one), or queue it to be started as soon as the current one finishes (with or without
+ *   stopping in between), does not block. If a mark of the last sentence is given, wait until the
+ *   word it anchors is being said first.
+ * - `await speech|motion|both`: block until the last sentence and/or motion has finished.
+ * - `pause <seconds> [speech|motion|now]`: block until the given time has elapsed since the end
+ *   of the last sentence (default), since the end of the last motion, or since now.
+ * - `offset <milliseconds> [speech|motion]`: block until the given time has elapsed since the
+ *   last sentence (default) or motion was started, e.g. to start a motion partway into a sentence.
+ *
+ * Cues are run one after another by a single scheduler. Since sentences and motions do not block,
+ * both run concurrently between the cues that do, which resume on the completion events of the
+ * robot and the TTS server or at their deadline. There are no parallel branches, though: a cue
+ * that blocks holds back all the cues that follow it.
+ */
+class Timeline
+{
+public:
+    struct Cue
+    {
+        enum class Type { Speak, Move, Await, Pause, Offset };
+        enum class Target { Speech, Motion, Both, Now };
+
+        Type type;
+        std::string label; // sentence or action
+        std::string mark; // word of the last sentence a motion waits for, if any
+        Target target {Target::Speech};
+        double seconds {0.0};
+        ActionPolicy policy {POLICY_REPLACE};
+        int line {0};
+    };
+
+    bool fromFile(const std::string & path);
+
+    const std::vector<Cue> & getCues() const
+    { return cues; }
+
+private:
+    std::vector<Cue> cues;
+};
+
+} // namespace roboticslab
+
+#endif // __TIMELINE_HPP__
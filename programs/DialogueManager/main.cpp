@@ -37,5 +37,6 @@ int main(int argc, char * argv[])
         return 1;
     }
 
-    return mod.runModule(rf);
+    int ret = mod.runModule(rf);
+    return ret == 0 && mod.hasRegressed() ? 1 : ret;
 }
@@ -0,0 +1,157 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#include "FakeSpeechSynthesis.hpp"
+
+#include <iterator> // std::istream_iterator
+#include <sstream>
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/SystemClock.h>
+
+using namespace roboticslab;
+
+constexpr auto DEFAULT_PREFIX = "/tts";
+constexpr auto DEFAULT_SECONDS_PER_WORD = 0.3; // [s]
+constexpr auto DEFAULT_SAY_LATENCY = 0.0; // [s]
+
+bool FakeSpeechSynthesis::configure(yarp::os::ResourceFinder & rf)
+{
+    auto prefix = rf.check("name", yarp::os::Value(DEFAULT_PREFIX), "port prefix").asString();
+    secondsPerWord = rf.check("secondsPerWord", yarp::os::Value(DEFAULT_SECONDS_PER_WORD), "utterance duration per word [s]").asFloat64();
+    sayLatency = rf.check("sayLatency", yarp::os::Value(DEFAULT_SAY_LATENCY), "emulated synthesis latency [s]").asFloat64();
+
+    if (rf.check("help"))
+    {
+        yInfo("FakeSpeechSynthesis options:");
+        yInfo("\t--help (this help)\t--from [file.ini]\t--context [path]");
+        yInfo("\t--name: %s [%s]", prefix.c_str(), DEFAULT_PREFIX);
+        yInfo("\t--secondsPerWord: %f [%f]", secondsPerWord, DEFAULT_SECONDS_PER_WORD);
+        yInfo("\t--sayLatency: %f [%f]", sayLatency, DEFAULT_SAY_LATENCY);
+        return false;
+    }
+
+    if (!serverPort.open(prefix + "/rpc:s"))
+    {
+        yError() << "Unable to open RPC port";
+        return false;
+    }
+
+    if (!timingPort.open(prefix + "/timing/rpc:s"))
+    {
+        yError() << "Unable to open timing RPC port";
+        return false;
+    }
+
+    return yarp::os::Wire::yarp().attachAsServer(serverPort) && timing.yarp().attachAsServer(timingPort);
+}
+
+bool FakeSpeechSynthesis::close()
+{
+    serverPort.close();
+    timingPort.close();
+    return true;
+}
+
+bool FakeSpeechSynthesis::interruptModule()
+{
+    serverPort.interrupt();
+    timingPort.interrupt();
+    yInfo() << "Served" << sayCalls << "say and" << checkSayDoneCalls << "checkSayDone requests";
+    return true;
+}
+
+double FakeSpeechSynthesis::getPeriod()
+{
+    return 1.0; // [s]
+}
+
+bool FakeSpeechSynthesis::updateModule()
+{
+    return true;
+}
+
+bool FakeSpeechSynthesis::setLanguage(const std::string & _language)
+{
+    std::lock_guard lock(mutex);
+    language = _language;
+    return true;
+}
+
+std::vector<std::string> FakeSpeechSynthesis::getSupportedLangs()
+{
+    std::lock_guard lock(mutex);
+    return {language};
+}
+
+bool FakeSpeechSynthesis::setSpeed(std::int16_t)
+{
+    return true;
+}
+
+bool FakeSpeechSynthesis::setPitch(std::int16_t)
+{
+    return true;
+}
+
+std::int16_t FakeSpeechSynthesis::getSpeed()
+{
+    return 0;
+}
+
+std::int16_t FakeSpeechSynthesis::getPitch()
+{
+    return 0;
+}
+
+bool FakeSpeechSynthesis::say(const std::string & text)
+{
+    sayCalls++;
+
+    std::istringstream iss(text);
+    auto words = std::distance(std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>());
+
+    yarp::os::SystemClock::delaySystem(sayLatency);
+
+    std::lock_guard lock(mutex);
+    utteranceEnd = yarp::os::SystemClock::nowSystem() + words * secondsPerWord;
+    utteranceWords = words;
+    return true;
+}
+
+bool FakeSpeechSynthesis::play()
+{
+    return true;
+}
+
+bool FakeSpeechSynthesis::pause()
+{
+    return true;
+}
+
+bool FakeSpeechSynthesis::stop()
+{
+    std::lock_guard lock(mutex);
+    utteranceEnd = 0.0;
+    utteranceWords = 0;
+    return true;
+}
+
+bool FakeSpeechSynthesis::checkSayDone()
+{
+    checkSayDoneCalls++;
+    std::lock_guard lock(mutex);
+    return yarp::os::SystemClock::nowSystem() >= utteranceEnd;
+}
+
+std::vector<double> FakeSpeechSynthesis::Timing::getWordOffsets()
+{
+    std::lock_guard lock(owner.mutex);
+    std::vector<double> offsets(owner.utteranceWords);
+
+    for (auto i = 0; i < offsets.size(); i++)
+    {
+        offsets[i] = i * owner.secondsPerWord;
+    }
+
+    return offsets;
+}
@@ -0,0 +1,84 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+#ifndef __FAKE_SPEECH_SYNTHESIS_HPP__
+#define __FAKE_SPEECH_SYNTHESIS_HPP__
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <yarp/os/RFModule.h>
+#include <yarp/os/RpcServer.h>
+
+#include <SpeechSynthesis.h>
+
+#include "SpeechTiming.h"
+
+namespace roboticslab
+{
+
+/**
+ * @ingroup teo-self-presentation_programs
+ * @brief Stand-in TTS server with deterministic utterance durations, meant for benchmarking.
+ *
+ * Nothing is played. Each utterance lasts a fixed amount of time per word, and say() may block
+ * for a fixed amount of time to emulate the synthesis latency of real backends. Word timing is
+ * served on a separate port through the SpeechTiming interface.
+ */
+class FakeSpeechSynthesis : public yarp::os::RFModule,
+                            public SpeechSynthesis
+{
+public:
+    ~FakeSpeechSynthesis()
+    { close(); }
+
+    bool configure(yarp::os::ResourceFinder & rf) override;
+    bool close() override;
+    bool interruptModule() override;
+    double getPeriod() override;
+    bool updateModule() override;
+
+    bool setLanguage(const std::string & language) override;
+    std::vector<std::string> getSupportedLangs() override;
+    bool setSpeed(std::int16_t speed) override;
+    bool setPitch(std::int16_t pitch) override;
+    std::int16_t getSpeed() override;
+    std::int16_t getPitch() override;
+    bool say(const std::string & text) override;
+    bool play() override;
+    bool pause() override;
+    bool stop() override;
+    bool checkSayDone() override;
+
+private:
+    class Timing : public SpeechTiming
+    {
+    public:
+        explicit Timing(FakeSpeechSynthesis & _owner) : owner(_owner) {}
+        std::vector<double> getWordOffsets() override;
+
+    private:
+        FakeSpeechSynthesis & owner;
+    };
+
+    double secondsPerWord {0.0};
+    double sayLatency {0.0};
+
+    std::mutex mutex;
+    double utteranceEnd {0.0};
+    std::string language;
+    std::size_t utteranceWords {0};
+
+    std::atomic<unsigned int> sayCalls {0};
+    std::atomic<unsigned int> checkSayDoneCalls {0};
+
+    yarp::os::RpcServer serverPort;
+
+    Timing timing {*this};
+    yarp::os::RpcServer timingPort;
+};
+
+} // namespace roboticslab
+
+#endif // __FAKE_SPEECH_SYNTHESIS_HPP__
@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+# Runs the presentation once against fake boards and a fake TTS server on a private YARP network,
+# then compares the results with a baseline (see teo-self-presentation_benchmark.xml).
+# Usage: benchmark.sh <bin dir> <share dir> <baseline.ini>
+# Exits with 77 (skipped) if the fake devices are not available in this YARP installation.
+
+set -u
+
+bin=$1
+share=$2
+baseline=$3
+
+workdir=$(mktemp -d)
+pids=()
+
+cleanup()
+{
+    kill "${pids[@]}" 2>/dev/null
+    wait 2>/dev/null
+    rm -rf "$workdir"
+}
+
+trap cleanup EXIT
+
+# keep the namespace configuration away from the user's one
+export YARP_CONF=$workdir/conf
+export YARP_NAMESPACE=/teoSelfPresentationBenchmark
+export YARP_DATA_DIRS=$share${YARP_DATA_DIRS:+:$YARP_DATA_DIRS}
+
+await_port()
+{
+    for _ in $(seq 100); do
+        yarp exists "$1" >/dev/null 2>&1 && return 0
+        sleep 0.1
+    done
+
+    echo "Timed out waiting for port $1" >&2
+    return 1
+}
+
+yarpserver --ip 127.0.0.1 --socket $((20000 + RANDOM % 20000)) --write >"$workdir/yarpserver.log" 2>&1 &
+pids+=($!)
+await_port /root || exit 1
+
+for part in Head LeftArm RightArm; do
+    yarpdev --context bodyExecution --from fake$part.ini >"$workdir/fake$part.log" 2>&1 &
+    pids+=($!)
+done
+
+for part in head leftArm rightArm; do
+    await_port /teoFake/$part/rpc:i || { cat "$workdir"/fake*.log >&2; exit 77; }
+done
+
+"$bin/fakeSpeechSynthesis" --name /tts --secondsPerWord 0.3 &
+pids+=($!)
+
+"$bin/bodyExecution" --robot /teoFake --validationCache "$workdir/validation.cache" &
+pids+=($!)
+
+cd "$workdir" || exit 1
+"$bin/dialogueManager" --language english --backend espeak --benchmark --baseline "$baseline" &
+manager=$!
+
+await_port /tts/rpc:s || exit 1
+await_port /tts/timing/rpc:s || exit 1
+await_port /bodyExecution/rpc:s || exit 1
+await_port /dialogueManager/tts/rpc:c || exit 1
+
+yarp connect /dialogueManager/motion/rpc:c /bodyExecution/rpc:s
+yarp connect /bodyExecution/state:o /dialogueManager/motion/state:i
+yarp connect /dialogueManager/tts/timing/rpc:c /tts/timing/rpc:s
+yarp connect /dialogueManager/tts/rpc:c /tts/rpc:s # starts the presentation
+
+wait $manager
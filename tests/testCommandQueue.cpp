@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+// Stress test of the command queue: several producers push numbered items concurrently while a
+// single consumer pops them. Every item must arrive exactly once and in the order of its producer.
+
+#include <cstdio> // std::fprintf, std::printf
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "CommandQueue.hpp"
+
+using namespace roboticslab;
+
+constexpr auto PRODUCERS = 8;
+constexpr auto ITEMS_PER_PRODUCER = 200000;
+
+namespace
+{
+    struct Item
+    {
+        int producer { -1 };
+        int sequence { -1 };
+    };
+}
+
+int main()
+{
+    CommandQueue<Item, 16> queue; // small, so that producers often find it full
+    std::atomic<bool> go { false };
+    std::atomic<long> retries { 0 };
+    std::vector<std::thread> producers;
+
+    for (auto p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&queue, &go, &retries, p] {
+            while (!go) {}
+
+            for (auto i = 0; i < ITEMS_PER_PRODUCER; i++)
+            {
+                while (!queue.push({p, i}))
+                {
+                    retries++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> expected(PRODUCERS, 0);
+    long received = 0;
+    bool ok = true;
+
+    go = true;
+
+    while (received < static_cast<long>(PRODUCERS) * ITEMS_PER_PRODUCER)
+    {
+        Item item;
+
+        if (!queue.pop(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (item.producer < 0 || item.producer >= PRODUCERS || item.sequence != expected[item.producer])
+        {
+            std::fprintf(stderr, "Unexpected item %d from producer %d\n", item.sequence, item.producer);
+            ok = false;
+            break;
+        }
+
+        expected[item.producer]++;
+        received++;
+    }
+
+    for (auto & producer : producers)
+    {
+        producer.join();
+    }
+
+    Item extra;
+
+    if (ok && queue.pop(extra))
+    {
+        std::fprintf(stderr, "Queue not empty after all items were received\n");
+        ok = false;
+    }
+
+    std::printf("%ld items from %d producers, %ld pushes retried on a full queue\n", received, PRODUCERS, retries.load());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+
+// Checks that dispatching a waypoint in position mode does not allocate: command queue, profile
+// planning and the construction of (shadowed) reference speeds, accelerations and targets, then
+// the same through the per-part worker pool (--partDispatch) along with the skew statistics.
+
+#include <cstdio> // std::fprintf
+#include <cstdlib> // std::free, std::malloc
+
+#include <array>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "ActionCommand.hpp"
+#include "LatencyStatistics.hpp"
+#include "MotionLibrary.hpp"
+#include "ReferenceShadow.hpp"
+#include "TrajectoryPlanner.hpp"
+#include "WorkerPool.hpp"
+
+namespace
+{
+    std::atomic<long> allocations {0};
+}
+
+void * operator new(std::size_t size)
+{
+    allocations++;
+
+    if (auto * p = std::malloc(size != 0 ? size : 1))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+using namespace roboticslab;
+
+constexpr std::size_t NUM_AXES = 14;
+constexpr auto CYCLES = 1000;
+
+// head, left arm, right arm
+constexpr std::size_t NUM_PARTS = 3;
+constexpr std::array<int, NUM_PARTS + 1> PART_OFFSETS = {0, 2, 8, 14};
+
+int main()
+{
+    MotionLibrary library;
+
+    if (!library.fromConfigFile(MOTIONS_INI) || library.getNumAxes() != NUM_AXES)
+    {
+        std::fprintf(stderr, "Unable to load %s\n", MOTIONS_INI);
+        return 1;
+    }
+
+    TrajectoryPlanner planner;
+
+    if (!planner.configure(library, {std::vector(NUM_AXES, 25.0), std::vector(NUM_AXES, 25.0), std::vector(NUM_AXES, 100.0)}))
+    {
+        std::fprintf(stderr, "Unable to configure planner\n");
+        return 1;
+    }
+
+    ActionQueue commands;
+    ReferenceShadow<double, NUM_AXES> refSpeedShadow(0.01);
+    ReferenceShadow<double, NUM_AXES> refAccelerationShadow(0.01);
+    const auto * action = library.find("explanation4");
+
+    auto sent = 0;
+    auto send = [&sent](auto n, auto *, auto *) { sent += n; return true; };
+
+    auto before = allocations.load();
+
+    for (auto cycle = 0; cycle < CYCLES; cycle++)
+    {
+        if (!commands.push({ActionCommand::Type::Execute, action, cycle + 1, ActionCommand::Policy::Enqueue}))
+        {
+            std::fprintf(stderr, "Command queue is full\n");
+            return 1;
+        }
+
+        ActionCommand command;
+
+        while (commands.pop(command)) {}
+
+        for (auto k = 1; k < command.action->size; k++)
+        {
+            const auto * q = command.action->waypoint(k - 1, NUM_AXES);
+            const auto * targets = command.action->waypoint(k, NUM_AXES);
+
+            auto profile = planner.plan(q, targets).stretch(1.0 + cycle % 3);
+
+            std::array<int, NUM_AXES> indices;
+            std::array<double, NUM_AXES> refSpeeds;
+            std::array<double, NUM_AXES> refAccelerations;
+            std::array<double, NUM_AXES> groupTargets;
+
+            int n = planner.getReferences(profile, q, targets, indices.data(), refSpeeds.data(), refAccelerations.data(), groupTargets.data());
+
+            refSpeedShadow.update(n, indices.data(), refSpeeds.data(), 0, send);
+            refAccelerationShadow.update(n, indices.data(), refAccelerations.data(), 0, send);
+        }
+    }
+
+    auto count = allocations.load() - before;
+
+    std::printf("%d cycles, %d joint references sent, %ld heap allocations\n", CYCLES, sent, count);
+
+    // same as BodyExecution::dispatchToParts()
+    const auto * partAction = library.find("explanationSensors"); // name longer than the SSO buffer
+    WorkerPool pool(NUM_PARTS);
+    LatencyStatistics skew("testSetpointDispatch", 0.0005, 100);
+    std::array<std::atomic<int>, NUM_PARTS> partSent {};
+
+    auto dispatch = [&](const double * q, const double * targets, double stretch) {
+        auto profile = planner.plan(q, targets).stretch(stretch);
+
+        std::array<int, NUM_AXES> indices;
+        std::array<double, NUM_AXES> refSpeeds;
+        std::array<double, NUM_AXES> refAccelerations;
+        std::array<double, NUM_AXES> groupTargets;
+
+        int n = planner.getReferences(profile, q, targets, indices.data(), refSpeeds.data(), refAccelerations.data(), groupTargets.data());
+
+        std::array<int, NUM_AXES> localIndices;
+        std::array<int, NUM_PARTS> begin;
+        std::array<int, NUM_PARTS> end;
+
+        for (auto p = 0, k = 0; p < NUM_PARTS; p++)
+        {
+            begin[p] = k;
+
+            while (k < n && indices[k] < PART_OFFSETS[p + 1])
+            {
+                localIndices[k] = indices[k] - PART_OFFSETS[p];
+                k++;
+            }
+
+            end[p] = k;
+        }
+
+        std::array<double, NUM_PARTS> started {};
+
+        pool.run(NUM_PARTS, [&](std::size_t p) {
+            if (begin[p] == end[p])
+            {
+                return;
+            }
+
+            auto partSend = [&partSent, p](auto m, auto *, auto *) { partSent[p] += m; return true; };
+            const auto b = begin[p];
+
+            refSpeedShadow.update(end[p] - b, localIndices.data() + b, refSpeeds.data() + b, PART_OFFSETS[p], partSend);
+            refAccelerationShadow.update(end[p] - b, localIndices.data() + b, refAccelerations.data() + b, PART_OFFSETS[p], partSend);
+            started[p] = end[p] - b; // stand-in for the dispatch timestamp
+        });
+
+        skew.record(partAction->name, "part_start_skew", started[2] - started[0]);
+    };
+
+    dispatch(partAction->waypoint(0, NUM_AXES), partAction->waypoint(1, NUM_AXES), 1.0); // first sample of a key is stored
+
+    before = allocations.load();
+
+    for (auto cycle = 0; cycle < CYCLES; cycle++)
+    {
+        for (auto k = 1; k < partAction->size; k++)
+        {
+            dispatch(partAction->waypoint(k - 1, NUM_AXES), partAction->waypoint(k, NUM_AXES), 1.0 + cycle % 3);
+        }
+    }
+
+    auto partCount = allocations.load() - before;
+    auto totalPartSent = partSent[0] + partSent[1] + partSent[2];
+
+    std::printf("%d cycles with part dispatch, %d joint references sent, %ld heap allocations\n", CYCLES, totalPartSent, partCount);
+    return count == 0 && sent != 0 && partCount == 0 && totalPartSent != 0 ? 0 : 1;
+}